@@ -0,0 +1,79 @@
+#include "bloom_filter.h"
+#include "hash_join.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace JoinOperations {
+
+BloomFilter::BloomFilter(size_t expected_keys, size_t bits_per_key,
+                         bool numeric_as_double)
+    : numeric_as_double(numeric_as_double) {
+  // Whole words, at least one; k = bits per key * ln 2 minimizes false
+  // positives
+  size_t words = (std::max<size_t>(1, expected_keys * bits_per_key) + 63) / 64;
+  bits.assign(words, 0);
+  bit_count = words * 64;
+  hash_count = std::clamp(
+      static_cast<int>(std::lround(bits_per_key * std::log(2.0))), 1, 16);
+}
+
+uint64_t BloomFilter::hash_value(const Value &value, bool numeric_as_double) {
+  return std::hash<std::string>()(hash_join_key(value, numeric_as_double));
+}
+
+// Enhanced double hashing: the probes step through h1 by h2, and h2 grows
+// by one more each step so that small filters do not repeat a stride. h2 is
+// derived from h1.
+uint64_t BloomFilter::second_hash(uint64_t h1) {
+  return ((h1 >> 32) | (h1 << 32)) * 0x9e3779b97f4a7c15ULL;
+}
+
+void BloomFilter::add(const Value &key) {
+  uint64_t h1 = hash_value(key, numeric_as_double);
+  uint64_t h2 = second_hash(h1);
+  bool new_bits = false;
+  for (int i = 0; i < hash_count; ++i) {
+    size_t bit = h1 % bit_count;
+    uint64_t mask = uint64_t(1) << (bit % 64);
+    new_bits |= !(bits[bit / 64] & mask);
+    bits[bit / 64] |= mask;
+    h1 += h2;
+    h2 += i;
+  }
+  // A repeated key sets no new bit and does not fill the filter further
+  if (new_bits) {
+    key_count++;
+  }
+}
+
+bool BloomFilter::may_contain(const Value &key) const {
+  uint64_t h1 = hash_value(key, numeric_as_double);
+  uint64_t h2 = second_hash(h1);
+  for (int i = 0; i < hash_count; ++i) {
+    size_t bit = h1 % bit_count;
+    if (!(bits[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+      return false;
+    }
+    h1 += h2;
+    h2 += i;
+  }
+  return true;
+}
+
+bool BloomFilter::probe(const Value &key) {
+  probes++;
+  if (may_contain(key)) {
+    return true;
+  }
+  rejections++;
+  return false;
+}
+
+double BloomFilter::expected_false_positive_rate() const {
+  double fill = 1.0 - std::exp(-static_cast<double>(hash_count) * key_count /
+                               bit_count);
+  return std::pow(fill, hash_count);
+}
+
+} // namespace JoinOperations
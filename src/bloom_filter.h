@@ -0,0 +1,56 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include "schema.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace JoinOperations {
+
+// Bloom filter over join key values, used to drop rows of one join input
+// whose key the other input lacks before they are sorted. Keys are hashed
+// like hash_join keys, so with numeric_as_double an Int64 and the equal
+// Double hit the same bits.
+class BloomFilter {
+private:
+  std::vector<uint64_t> bits;
+  size_t bit_count;
+  int hash_count;
+  size_t key_count = 0;
+  bool numeric_as_double;
+
+  // Rows tested by probe() and how many of them it rejected
+  size_t probes = 0;
+  size_t rejections = 0;
+
+  static uint64_t hash_value(const Value &value, bool numeric_as_double);
+  static uint64_t second_hash(uint64_t h1);
+
+public:
+  // About 1% false positives
+  static constexpr size_t DEFAULT_BITS_PER_KEY = 10;
+
+  BloomFilter(size_t expected_keys, size_t bits_per_key,
+              bool numeric_as_double);
+
+  void add(const Value &key);
+  bool may_contain(const Value &key) const;
+  // may_contain that also counts the rows tested and rejected; called by
+  // one scanning thread
+  bool probe(const Value &key);
+
+  // Keys that set at least one new bit: distinct keys, short of the rare
+  // one whose bits were all set already
+  size_t get_key_count() const { return key_count; }
+  size_t get_bit_count() const { return bit_count; }
+  int get_hash_count() const { return hash_count; }
+  size_t get_probe_count() const { return probes; }
+  size_t get_rejection_count() const { return rejections; }
+  // False-positive rate predicted from the bits, hashes and keys added
+  double expected_false_positive_rate() const;
+};
+
+} // namespace JoinOperations
+
+#endif // BLOOM_FILTER_H
@@ -0,0 +1,201 @@
+#include "bplus_tree.h"
+#include "buffer_manager.h"
+#include "spill_table.h"
+#include "table.h"
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace JoinOperations {
+
+namespace {
+
+// Columns of an index node row
+const size_t KEY_COLUMN = 0;
+const size_t PAGE_COLUMN = 1;
+const size_t SLOT_COLUMN = 2;
+
+Schema index_schema(const Column &key_column) {
+  return Schema({Column("key", key_column.type, key_column.length),
+                 Column("page", ColumnType::Int64),
+                 Column("slot", ColumnType::Int64)});
+}
+
+Value node_key(const Page &page, size_t row) {
+  return page.schema->column_value(page.rows[row], KEY_COLUMN);
+}
+
+int64_t node_pointer(const Page &page, size_t row, size_t column) {
+  return std::get<int64_t>(page.schema->column_value(page.rows[row], column));
+}
+
+} // namespace
+
+BPlusTree::BPlusTree(std::shared_ptr<BufferManager> bm, const Table &table,
+                     const std::string &column_name)
+    : buffer_manager(std::move(bm)), table_name(table.get_name()),
+      column(column_name), table_id(table.get_table_id()),
+      version(buffer_manager->get_table_version(table_id)), root_page(0),
+      height(1), leaf_pages(0), entry_count(0) {}
+
+std::shared_ptr<BPlusTree>
+BPlusTree::bulk_load(std::shared_ptr<Table> table,
+                     const std::string &column_name,
+                     std::shared_ptr<BufferManager> buffer_manager,
+                     const JoinOptions &options) {
+  int col_idx = table->get_column_index(column_name);
+  if (col_idx == -1) {
+    throw std::runtime_error("Index column not found: " + column_name);
+  }
+  std::shared_ptr<BPlusTree> tree(
+      new BPlusTree(buffer_manager, *table, column_name));
+  const Schema schema = index_schema(table->get_schema()[col_idx]);
+
+  // One entry per row, in table order
+  SpillTable entry_spill(table->get_name() + "_index_entries", schema,
+                         buffer_manager);
+  RowArena entry;
+  for (int p = 0; p < table->get_total_pages(); ++p) {
+    auto page = buffer_manager->get_page(table->get_table_id(), p,
+                                         AccessHint::Sequential);
+    for (size_t r = 0; r < page->rows.size(); ++r) {
+      entry.clear();
+      entry.append(schema, Row({table->get_schema().column_value(
+                                    page->rows[r], col_idx),
+                                int64_t(p), int64_t(r)}));
+      entry_spill.add(entry.front());
+    }
+  }
+  auto entries = entry_spill.finish();
+
+  // Rows of a table already ordered on the column give sorted entries
+  std::shared_ptr<Table> sorted = entries;
+  if (table->get_sort_column() != column_name) {
+    sorted = external_sort(entries, "key", buffer_manager, options);
+  }
+
+  tree->index_table = std::make_shared<Table>(
+      table->get_name() + "_index_" + column_name, schema, buffer_manager);
+  tree->index_table->truncate();
+  tree->build_levels(*sorted);
+
+  if (sorted != entries) {
+    sorted->drop();
+  }
+  entries->drop();
+
+  std::cout << "Index on " << tree->table_name << "." << column_name << ": "
+            << tree->entry_count << " entries, " << tree->get_total_pages()
+            << " pages (" << tree->leaf_pages << " leaves), height "
+            << tree->height << std::endl;
+  return tree;
+}
+
+void BPlusTree::build_levels(Table &sorted_entries) {
+  Table &index = *index_table;
+  int page_id = 0;
+  // Smallest key and page of each node of the level being written
+  std::vector<std::pair<Value, int64_t>> level;
+
+  auto node = index.new_page(page_id);
+  auto finish_node = [&](std::vector<std::pair<Value, int64_t>> &parents) {
+    parents.emplace_back(node_key(*node, 0), page_id);
+    index.write_page(node);
+    node = index.new_page(++page_id);
+  };
+
+  for (int p = 0; p < sorted_entries.get_total_pages(); ++p) {
+    auto page = sorted_entries.get_page(p);
+    for (size_t r = 0; r < page->rows.size(); ++r) {
+      if (!node->can_fit(page->rows[r])) {
+        finish_node(level);
+      }
+      node->add_row(page->rows[r]);
+      ++entry_count;
+    }
+  }
+  if (!node->rows.empty()) {
+    finish_node(level);
+  } else if (page_id == 0) {
+    // An empty table still gets a leaf, empty, as its root
+    index.write_page(node);
+    node = index.new_page(++page_id);
+  }
+  leaf_pages = page_id;
+
+  while (level.size() > 1) {
+    std::vector<std::pair<Value, int64_t>> parents;
+    for (auto &[key, child] : level) {
+      Row row({std::move(key), child, int64_t(-1)});
+      if (!node->can_fit(row)) {
+        finish_node(parents);
+      }
+      node->add_row(row);
+    }
+    finish_node(parents);
+    level = std::move(parents);
+    ++height;
+  }
+
+  root_page = page_id - 1;
+  index.set_total_pages(page_id);
+  index.set_sort_column("key");
+}
+
+void BPlusTree::lookup(const Value &key,
+                       std::vector<RowLocation> &matches) const {
+  const uint32_t index_id = index_table->get_table_id();
+  int page_id = root_page;
+
+  // Keys equal to `key` may start in the last child whose smallest key is
+  // below it, since a run of equal keys can cross leaves
+  for (int level = height; level > 1; --level) {
+    auto node = buffer_manager->get_page(index_id, page_id);
+    size_t lo = 0, hi = node->rows.size();
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (compare_values(node_key(*node, mid), key) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    page_id = static_cast<int>(
+        node_pointer(*node, lo == 0 ? 0 : lo - 1, PAGE_COLUMN));
+  }
+
+  for (; page_id < leaf_pages; ++page_id) {
+    auto leaf = buffer_manager->get_page(index_id, page_id);
+    size_t lo = 0, hi = leaf->rows.size();
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (compare_values(node_key(*leaf, mid), key) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    for (; lo < leaf->rows.size(); ++lo) {
+      if (compare_values(node_key(*leaf, lo), key) != 0) {
+        return;
+      }
+      matches.push_back(
+          {static_cast<int>(node_pointer(*leaf, lo, PAGE_COLUMN)),
+           static_cast<size_t>(node_pointer(*leaf, lo, SLOT_COLUMN))});
+    }
+  }
+}
+
+bool BPlusTree::covers(const Table &table,
+                       const std::string &column_name) const {
+  return table.get_table_id() == table_id && column_name == column &&
+         buffer_manager->get_table_version(table_id) == version;
+}
+
+void BPlusTree::drop() { index_table->drop(); }
+
+int BPlusTree::get_total_pages() const {
+  return index_table->get_total_pages();
+}
+
+} // namespace JoinOperations
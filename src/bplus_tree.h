@@ -0,0 +1,80 @@
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+#include "join_operation.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class BufferManager;
+class Table;
+
+namespace JoinOperations {
+
+// Where a row lives in its table
+struct RowLocation {
+  int page_id;
+  size_t slot; // Index of the row within the page
+};
+
+// Secondary B+-tree index over one column of a table, kept on disk as the
+// pages of a table of its own (<table>_index_<column>) and read through the
+// buffer pool. Every node is one page of rows (key, page, slot):
+//   leaf   one row per indexed row, pointing at its page and slot
+//   inner  one row per child, holding the child's smallest key, the child's
+//          page and a slot of -1
+// The tree is bulk loaded bottom-up from entries sorted by key, so leaves
+// are full, take pages 0 to leaf_pages - 1 in key order and are chained by
+// page id, and the root is the last page. The index is not maintained: a
+// write to the table leaves it stale and it has to be loaded again.
+class BPlusTree {
+private:
+  std::shared_ptr<BufferManager> buffer_manager;
+  std::shared_ptr<Table> index_table;
+  std::string table_name;
+  std::string column;
+  uint32_t table_id;     // Of the indexed table in the buffer manager
+  uint64_t version;      // Of the indexed table when the index was loaded
+  int root_page;
+  int height;            // Levels, counting the leaves
+  int leaf_pages;
+  size_t entry_count;
+
+  BPlusTree(std::shared_ptr<BufferManager> bm, const Table &table,
+            const std::string &column_name);
+
+  // Packs entries sorted by key into the leaves, then each level's smallest
+  // keys into the level above until one page holds them all. The keys of a
+  // level are kept in memory while the next one is written.
+  void build_levels(Table &sorted_entries);
+
+public:
+  // Indexes `column` of `table`: the table is scanned for (key, page, slot)
+  // entries, which are sorted by external_sort unless the table is already
+  // ordered on the column, then bulk loaded
+  static std::shared_ptr<BPlusTree>
+  bulk_load(std::shared_ptr<Table> table, const std::string &column,
+            std::shared_ptr<BufferManager> buffer_manager,
+            const JoinOptions &options = JoinOptions());
+
+  // Appends the location of every row whose key equals `key`, in key order
+  // of the entries. Reads one page per level, plus the following leaves
+  // while they continue the key.
+  void lookup(const Value &key, std::vector<RowLocation> &matches) const;
+
+  // Whether this indexes `column` of `table` as it is now
+  bool covers(const Table &table, const std::string &column_name) const;
+  // Deletes the index pages and file
+  void drop();
+
+  const std::string &get_table_name() const { return table_name; }
+  const std::string &get_column() const { return column; }
+  int get_height() const { return height; }
+  int get_leaf_pages() const { return leaf_pages; }
+  int get_total_pages() const;
+  size_t get_entry_count() const { return entry_count; }
+};
+
+} // namespace JoinOperations
+
+#endif // BPLUS_TREE_H
@@ -1,107 +1,449 @@
 #include "buffer_manager.h"
 #include "disk_manager.h"
 #include "table.h"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
 
-BufferManager::BufferManager(std::shared_ptr<DiskManager> dm)
-    : disk_manager(dm) {}
+BufferManager::BufferManager(std::shared_ptr<DiskManager> dm,
+                             size_t pool_size, size_t sort_pages,
+                             WritePolicy policy,
+                             ReplacementPolicyType replacement)
+    : disk_manager(dm), pool_pages(pool_size), sort_grant_pages(sort_pages),
+      write_policy(policy), hit_count(0), miss_count(0), loading_frames(0),
+      readahead_pages(0), stopping(false), prefetch_count(0),
+      read_ahead_serial(0) {
+  if (pool_pages < MIN_POOL_PAGES) {
+    throw std::runtime_error("Buffer pool needs at least " +
+                             std::to_string(MIN_POOL_PAGES) + " pages");
+  }
+  // Even the smallest pool reads a page ahead, within the frames left over
+  // when an operator pins all the pages it can
+  readahead_pages = std::clamp<size_t>(pool_pages / 8, 1,
+                                       pool_pages - (MIN_POOL_PAGES - 1));
+  if (sort_grant_pages == 0) {
+    sort_grant_pages = pool_pages - 1;
+  }
+  if (sort_grant_pages >= pool_pages) {
+    throw std::runtime_error("Sort grant must leave at least 1 pool page free");
+  }
+
+  frames.resize(pool_pages);
+  free_frames.reserve(pool_pages);
+  for (size_t i = pool_pages; i > 0; --i) {
+    free_frames.push_back(i - 1);
+  }
+  page_table.reserve(pool_pages);
+  replacer = make_replacement_policy(replacement, pool_pages);
+}
 
-std::string BufferManager::make_key(const std::string &table_name,
-                                    int page_id) {
-  return table_name + "_" + std::to_string(page_id);
+BufferManager::~BufferManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  prefetch_cv.notify_all();
+  if (prefetch_thread.joinable()) {
+    prefetch_thread.join();
+  }
+
+  try {
+    flush_all();
+  } catch (const std::exception &e) {
+    std::cerr << "Error flushing buffer pool: " << e.what() << std::endl;
+  }
 }
 
-std::shared_ptr<Page> BufferManager::get_page(const std::string &table_name,
-                                              int page_id) {
-  std::string key = make_key(table_name, page_id);
+size_t BufferManager::get_page_size() const {
+  return disk_manager->get_page_size();
+}
 
-  // Check if page is already in buffer
-  auto it = page_map.find(key);
-  if (it != page_map.end()) {
-    // Move to front of LRU list
-    auto page_it = it->second;
-    auto page_pair = *page_it;
-    lru_list.erase(page_it);
-    lru_list.push_front(page_pair);
-    page_map[key] = lru_list.begin();
+BufferManager::TableId
+BufferManager::register_table(const std::string &table_name,
+                              std::shared_ptr<const Schema> schema) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = table_ids.find(table_name);
+  if (it != table_ids.end()) {
+    table_schemas[it->second] = std::move(schema);
+    return it->second;
+  }
 
-    return page_pair.second;
+  TableId table_id = static_cast<TableId>(table_names.size());
+  table_names.push_back(table_name);
+  table_schemas.push_back(std::move(schema));
+  table_versions.push_back(0);
+  table_ids[table_name] = table_id;
+  return table_id;
+}
+
+// A page read ahead and not referenced yet, among the latest half a pool of
+// such pages; older ones belong to scans that stopped short of them
+bool BufferManager::awaits_scan(const Frame &frame) const {
+  return frame.read_ahead != 0 &&
+         frame.read_ahead + pool_pages / 2 > read_ahead_serial;
+}
+
+// Pages read ahead are installed at the cold end with the scan's pages, so
+// victims are first sought among the other unpinned frames. Read-ahead
+// never evicts them, lest one prefetch push out the one before it.
+size_t BufferManager::try_acquire_frame(bool for_read_ahead) {
+  if (!free_frames.empty()) {
+    size_t frame_id = free_frames.back();
+    free_frames.pop_back();
+    return frame_id;
+  }
+
+  size_t frame_id = replacer->pick_victim([this](size_t id) {
+    return frames[id].pin_count == 0 && !awaits_scan(frames[id]);
+  });
+  if (frame_id == ReplacementPolicy::NO_FRAME && !for_read_ahead) {
+    frame_id = replacer->pick_victim(
+        [this](size_t id) { return frames[id].pin_count == 0; });
+  }
+  if (frame_id != ReplacementPolicy::NO_FRAME) {
+    evict_page(frame_id);
+  }
+  return frame_id;
+}
+
+// With every frame pinned or loading, waits for a load to finish and
+// returns NO_FRAME, since the caller's page may have been loaded meanwhile
+size_t BufferManager::acquire_frame(std::unique_lock<std::mutex> &lock) {
+  size_t frame_id = try_acquire_frame();
+  if (frame_id == ReplacementPolicy::NO_FRAME) {
+    if (loading_frames == 0) {
+      throw std::runtime_error("Buffer pool exhausted: all " +
+                               std::to_string(pool_pages) +
+                               " frames are pinned");
+    }
+    load_cv.wait(lock);
   }
+  return frame_id;
+}
+
+void BufferManager::evict_page(size_t frame_id) {
+  Frame &frame = frames[frame_id];
 
-  // Page not in buffer, need to load from disk
-  if (is_buffer_full()) {
-    evict_page();
+  // Write to disk if dirty, taking the table's other dirty pages with it
+  if (frame.page->dirty) {
+    flush_table(frame.table_id);
   }
 
-  auto page = disk_manager->read_page(table_name, page_id);
+  // Remove from buffer
+  page_table.erase(frame.key);
+  replacer->remove(frame_id, true);
+  frame.page.reset();
+  frame.in_use = false;
+}
 
-  // Add to buffer
-  lru_list.push_front(std::make_pair(key, page));
-  page_map[key] = lru_list.begin();
+void BufferManager::install_page(size_t frame_id, TableId table_id,
+                                 std::shared_ptr<Page> page, AccessHint hint) {
+  Frame &frame = frames[frame_id];
+  frame.key = make_key(table_id, page->page_id);
+  frame.page = std::move(page);
+  frame.table_id = table_id;
+  frame.pin_count = 0;
+  frame.in_use = true;
+  frame.read_ahead = 0;
 
-  return page;
+  page_table[frame.key] = frame_id;
+  replacer->record_insert(frame_id, frame.key, hint);
 }
 
-void BufferManager::write_page(const std::string &table_name,
-                               std::shared_ptr<Page> page) {
-  std::string key = make_key(table_name, page->page_id);
+// Reads a page into a frame taken from the pool. The frame stays in the
+// page table as loading while the lock is released for the read, so other
+// lookups of the page wait for it instead of reading it again. Returns
+// false, with the frame freed, if the table was recreated or dropped during
+// the read.
+bool BufferManager::load_page(std::unique_lock<std::mutex> &lock,
+                              size_t frame_id, TableId table_id, int page_id,
+                              AccessHint hint) {
+  Frame &frame = frames[frame_id];
+  frame.key = make_key(table_id, page_id);
+  frame.table_id = table_id;
+  frame.loading = true;
+  page_table[frame.key] = frame_id;
+  loading_frames++;
+  std::string table_name = table_names[table_id];
+  std::shared_ptr<const Schema> schema = table_schemas[table_id];
+  lock.unlock();
+
+  std::shared_ptr<Page> page;
+  std::exception_ptr error;
+  try {
+    page = disk_manager->read_page(table_name, schema, page_id);
+  } catch (...) {
+    error = std::current_exception();
+  }
 
-  // Update page in buffer if it exists
-  auto it = page_map.find(key);
-  if (it != page_map.end()) {
-    auto page_it = it->second;
-    page_it->second = page;
-    page->dirty = true;
+  lock.lock();
+  frame.loading = false;
+  loading_frames--;
+  load_cv.notify_all();
+  auto it = page_table.find(frame.key);
+  bool current = it != page_table.end() && it->second == frame_id &&
+                 schema == table_schemas[table_id];
+  if (!current) {
+    free_frames.push_back(frame_id);
+    return false;
+  }
+  if (error) {
+    page_table.erase(it);
+    free_frames.push_back(frame_id);
+    std::rethrow_exception(error);
+  }
+  install_page(frame_id, table_id, std::move(page), hint);
+  return true;
+}
 
-    // Move to front of LRU list
-    auto page_pair = *page_it;
-    lru_list.erase(page_it);
-    lru_list.push_front(page_pair);
-    page_map[key] = lru_list.begin();
-  } else {
-    // Page not in buffer, add if there's space
-    if (is_buffer_full()) {
-      evict_page();
+size_t BufferManager::lookup_or_load(std::unique_lock<std::mutex> &lock,
+                                     TableId table_id, int page_id,
+                                     AccessHint hint) {
+  const uint64_t key = make_key(table_id, page_id);
+  while (true) {
+    // Check if page is already in buffer
+    auto it = page_table.find(key);
+    if (it != page_table.end()) {
+      Frame &frame = frames[it->second];
+      if (frame.loading) {
+        load_cv.wait(lock);
+        continue;
+      }
+      hit_count++;
+      frame.read_ahead = 0;
+      replacer->record_access(it->second, hint);
+      return it->second;
     }
 
-    page->dirty = true;
-    lru_list.push_front(std::make_pair(key, page));
-    page_map[key] = lru_list.begin();
+    // Page not in buffer, need to load from disk
+    size_t frame_id = acquire_frame(lock);
+    if (frame_id == ReplacementPolicy::NO_FRAME) {
+      continue;
+    }
+    miss_count++;
+    if (load_page(lock, frame_id, table_id, page_id, hint)) {
+      return frame_id;
+    }
   }
+}
 
-  // Write to disk immediately (write-through policy)
-  disk_manager->write_page(table_name, page);
-  page->dirty = false;
+std::shared_ptr<Page> BufferManager::get_page(TableId table_id, int page_id,
+                                              AccessHint hint) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return frames[lookup_or_load(lock, table_id, page_id, hint)].page;
 }
 
-void BufferManager::evict_page() {
-  if (lru_list.empty()) {
-    return;
+std::shared_ptr<Page> BufferManager::pin_page(TableId table_id, int page_id,
+                                              AccessHint hint) {
+  std::unique_lock<std::mutex> lock(mutex);
+  Frame &frame = frames[lookup_or_load(lock, table_id, page_id, hint)];
+  frame.pin_count++;
+  return frame.page;
+}
+
+void BufferManager::unpin_page(TableId table_id, int page_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = page_table.find(make_key(table_id, page_id));
+  if (it == page_table.end() || frames[it->second].pin_count == 0) {
+    throw std::runtime_error("Unpin of page " + std::to_string(page_id) +
+                             " of " + table_names[table_id] +
+                             " which is not pinned");
   }
+  frames[it->second].pin_count--;
+}
 
-  // Get least recently used page
-  auto last_pair = lru_list.back();
-  auto page = last_pair.second;
+void BufferManager::write_page(TableId table_id, std::shared_ptr<Page> page) {
+  std::unique_lock<std::mutex> lock(mutex);
+  uint64_t key = make_key(table_id, page->page_id);
 
-  // Write to disk if dirty
-  if (page->dirty) {
-    size_t underscore_pos = last_pair.first.find_last_of('_');
-    std::string table_name = last_pair.first.substr(0, underscore_pos);
-    disk_manager->write_page(table_name, page);
+  while (true) {
+    // Update page in buffer if it exists, once any read of it is done
+    auto it = page_table.find(key);
+    if (it != page_table.end()) {
+      if (frames[it->second].loading) {
+        load_cv.wait(lock);
+        continue;
+      }
+      frames[it->second].page = page;
+      frames[it->second].read_ahead = 0;
+      replacer->record_access(it->second, AccessHint::Normal);
+      break;
+    }
+    // Page not in buffer, take a frame for it
+    size_t frame_id = acquire_frame(lock);
+    if (frame_id != ReplacementPolicy::NO_FRAME) {
+      install_page(frame_id, table_id, page, AccessHint::Normal);
+      break;
+    }
   }
+  table_versions[table_id]++;
+  page->dirty = true;
 
-  // Remove from buffer
-  page_map.erase(last_pair.first);
-  lru_list.pop_back();
+  if (write_policy == WritePolicy::WriteThrough) {
+    disk_manager->write_page(table_names[table_id], page);
+    page->dirty = false;
+  }
+}
+
+// Caller holds the mutex
+void BufferManager::discard_frames(TableId table_id) {
+  table_versions[table_id]++;
+  prefetch_queue.erase(
+      std::remove_if(prefetch_queue.begin(), prefetch_queue.end(),
+                     [table_id](const std::pair<TableId, int> &request) {
+                       return request.first == table_id;
+                     }),
+      prefetch_queue.end());
+
+  for (size_t frame_id = 0; frame_id < frames.size(); ++frame_id) {
+    Frame &frame = frames[frame_id];
+    if (frame.loading && frame.table_id == table_id) {
+      // The loading thread finds its entry gone and frees the frame
+      page_table.erase(frame.key);
+      continue;
+    }
+    if (!frame.in_use || frame.table_id != table_id) {
+      continue;
+    }
+    if (frame.pin_count > 0) {
+      throw std::runtime_error("Cannot discard table " +
+                               table_names[table_id] +
+                               " while its pages are pinned");
+    }
+
+    page_table.erase(frame.key);
+    replacer->remove(frame_id, false);
+    frame.page.reset();
+    frame.in_use = false;
+    free_frames.push_back(frame_id);
+  }
+}
+
+void BufferManager::create_table(TableId table_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Drop cached pages of any previous incarnation without writing them back
+  discard_frames(table_id);
+  disk_manager->create_table_file(table_names[table_id]);
+}
+
+void BufferManager::drop_table(TableId table_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  discard_frames(table_id);
+  disk_manager->remove_table_file(table_names[table_id]);
+}
+
+void BufferManager::flush_frames(std::vector<size_t> &frame_ids) {
+  std::sort(frame_ids.begin(), frame_ids.end(), [this](size_t a, size_t b) {
+    return frames[a].key < frames[b].key;
+  });
+
+  // Coalesce runs of consecutive page ids of the same table into one write
+  std::vector<std::shared_ptr<Page>> batch;
+  TableId batch_table = 0;
+
+  for (size_t frame_id : frame_ids) {
+    const Frame &frame = frames[frame_id];
+    bool extends_batch =
+        !batch.empty() && frame.table_id == batch_table &&
+        frame.page->page_id == batch.back()->page_id + 1;
+
+    if (!batch.empty() && !extends_batch) {
+      disk_manager->write_pages(table_names[batch_table], batch);
+      batch.clear();
+    }
+
+    batch_table = frame.table_id;
+    batch.push_back(frame.page);
+  }
+
+  if (!batch.empty()) {
+    disk_manager->write_pages(table_names[batch_table], batch);
+  }
+}
+
+void BufferManager::flush_table(TableId table_id) {
+  std::vector<size_t> dirty_frames;
+  for (size_t frame_id = 0; frame_id < frames.size(); ++frame_id) {
+    const Frame &frame = frames[frame_id];
+    if (frame.in_use && frame.table_id == table_id && frame.page->dirty) {
+      dirty_frames.push_back(frame_id);
+    }
+  }
+  flush_frames(dirty_frames);
 }
 
 void BufferManager::flush_all() {
-  for (auto &pair : lru_list) {
-    auto page = pair.second;
-    if (page->dirty) {
-      size_t underscore_pos = pair.first.find_last_of('_');
-      std::string table_name = pair.first.substr(0, underscore_pos);
-      disk_manager->write_page(table_name, page);
-      page->dirty = false;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<size_t> dirty_frames;
+  for (size_t frame_id = 0; frame_id < frames.size(); ++frame_id) {
+    const Frame &frame = frames[frame_id];
+    if (frame.in_use && frame.page->dirty) {
+      dirty_frames.push_back(frame_id);
+    }
+  }
+  flush_frames(dirty_frames);
+}
+
+void BufferManager::flush(TableId table_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  flush_table(table_id);
+}
+
+void BufferManager::set_readahead_pages(size_t pages) {
+  std::lock_guard<std::mutex> lock(mutex);
+  readahead_pages = pages;
+}
+
+void BufferManager::prefetch(TableId table_id, int first_page, int count) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (readahead_pages == 0 || count <= 0) {
+    return;
+  }
+
+  for (int page_id = first_page; page_id < first_page + count; ++page_id) {
+    if (page_table.count(make_key(table_id, page_id)) == 0) {
+      prefetch_queue.emplace_back(table_id, page_id);
+    }
+  }
+
+  if (!prefetch_thread.joinable()) {
+    prefetch_thread = std::thread(&BufferManager::prefetch_worker, this);
+  }
+  prefetch_cv.notify_one();
+}
+
+void BufferManager::prefetch_worker() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    prefetch_cv.wait(lock,
+                     [this] { return stopping || !prefetch_queue.empty(); });
+    if (stopping) {
+      return;
+    }
+
+    auto [table_id, page_id] = prefetch_queue.front();
+    prefetch_queue.pop_front();
+
+    if (page_table.count(make_key(table_id, page_id)) != 0) {
+      continue;
+    }
+
+    // A scan reaching the page while it is read waits for this load.
+    // Only sequential scans read ahead, so the page goes where their pages
+    // go and does not push out pages that are reused.
+    try {
+      size_t frame_id = try_acquire_frame(true);
+      if (frame_id != ReplacementPolicy::NO_FRAME &&
+          load_page(lock, frame_id, table_id, page_id,
+                    AccessHint::Sequential)) {
+        frames[frame_id].read_ahead = ++read_ahead_serial;
+        prefetch_count++;
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Read-ahead of " << table_names[table_id] << " page "
+                << page_id << " failed: " << e.what() << std::endl;
     }
   }
 }
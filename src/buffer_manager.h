@@ -1,39 +1,203 @@
 #ifndef BUFFER_MANAGER_H
 #define BUFFER_MANAGER_H
-#include <list>
+#include "replacement_policy.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 class DiskManager;
 class Page;
+class Schema;
 
+// All public methods are thread-safe. Pages are read from disk without
+// holding the pool lock, so a miss does not stall hits on other threads.
+// When read-ahead is enabled a background thread loads prefetched pages
+// into the pool.
 class BufferManager {
+public:
+  using TableId = uint32_t;
+
+  // Write-through sends every page write straight to disk. Write-back keeps
+  // dirty pages in the pool and flushes them in page-id order, coalescing
+  // consecutive pages into one write, on eviction or flush_all().
+  enum class WritePolicy { WriteThrough, WriteBack };
+
+  static const size_t DEFAULT_POOL_PAGES = 4;
+  // A merge join pins a page of each input and one of a spilled key group,
+  // and its output and spill pages need one more frame
+  static const size_t MIN_POOL_PAGES = 4;
+
 private:
-  static const size_t BUFFER_SIZE = 4; // Maximum 4 pages in memory
+  // A fixed slot of the pool. Replacement bookkeeping lives in the policy,
+  // indexed by frame id, so touching a resident page never allocates.
+  struct Frame {
+    std::shared_ptr<Page> page;
+    uint64_t key = 0;
+    TableId table_id = 0;
+    int pin_count = 0;
+    bool in_use = false;
+    // Entered in the page table while its page is read without the lock
+    bool loading = false;
+    // Set by read-ahead to the install's serial; cleared once referenced
+    uint64_t read_ahead = 0;
+  };
 
   std::shared_ptr<DiskManager> disk_manager;
+  size_t pool_pages;       // Maximum number of pages held in memory
+  size_t sort_grant_pages; // Pages an operator may use for sort buffers
+  WritePolicy write_policy;
+
+  std::vector<Frame> frames;
+  std::vector<size_t> free_frames;
+  std::unordered_map<uint64_t, size_t> page_table; // page key -> frame
+  std::unique_ptr<ReplacementPolicy> replacer;
+
+  size_t hit_count;
+  size_t miss_count;
+
+  std::deque<std::string> table_names; // Indexed by TableId
+  std::deque<std::shared_ptr<const Schema>> table_schemas;
+  std::deque<uint64_t> table_versions; // Bumped on every change to a table
+  std::unordered_map<std::string, TableId> table_ids;
+
+  mutable std::mutex mutex;
+
+  // Threads looking up or writing a page being loaded wait on load_cv
+  std::condition_variable load_cv;
+  size_t loading_frames;
 
-  // LRU implementation
-  std::list<std::pair<std::string, std::shared_ptr<Page>>> lru_list;
-  std::unordered_map<
-      std::string,
-      std::list<std::pair<std::string, std::shared_ptr<Page>>>::iterator>
-      page_map;
+  // Read-ahead: requests are served in FIFO order by prefetch_thread
+  size_t readahead_pages;
+  std::deque<std::pair<TableId, int>> prefetch_queue;
+  std::condition_variable prefetch_cv;
+  std::thread prefetch_thread;
+  bool stopping;
+  size_t prefetch_count;
+  uint64_t read_ahead_serial; // Pages read ahead since construction
 
-  void evict_page();
-  std::string make_key(const std::string &table_name, int page_id);
+  static uint64_t make_key(TableId table_id, int page_id) {
+    return (static_cast<uint64_t>(table_id) << 32) |
+           static_cast<uint32_t>(page_id);
+  }
+
+  bool awaits_scan(const Frame &frame) const;
+  size_t try_acquire_frame(bool for_read_ahead = false);
+  size_t acquire_frame(std::unique_lock<std::mutex> &lock);
+  void evict_page(size_t frame_id);
+  void install_page(size_t frame_id, TableId table_id,
+                    std::shared_ptr<Page> page, AccessHint hint);
+  bool load_page(std::unique_lock<std::mutex> &lock, size_t frame_id,
+                 TableId table_id, int page_id, AccessHint hint);
+  void flush_frames(std::vector<size_t> &frame_ids);
+  void flush_table(TableId table_id);
+  void discard_frames(TableId table_id);
+  size_t lookup_or_load(std::unique_lock<std::mutex> &lock, TableId table_id,
+                        int page_id, AccessHint hint);
+  void prefetch_worker();
 
 public:
-  BufferManager(std::shared_ptr<DiskManager> dm);
+  // A sort grant of 0 reserves one page for buffer management and hands the
+  // rest of the pool to sort operators.
+  BufferManager(
+      std::shared_ptr<DiskManager> dm, size_t pool_size = DEFAULT_POOL_PAGES,
+      size_t sort_pages = 0, WritePolicy policy = WritePolicy::WriteBack,
+      ReplacementPolicyType replacement = ReplacementPolicyType::LRU);
+  ~BufferManager();
+
+  BufferManager(const BufferManager &) = delete;
+  BufferManager &operator=(const BufferManager &) = delete;
+
+  // Tables are addressed by a compact id; registering the same name twice
+  // returns the same id and replaces the schema used to decode its pages.
+  TableId register_table(const std::string &table_name,
+                         std::shared_ptr<const Schema> schema);
+  const std::string &get_table_name(TableId table_id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return table_names[table_id];
+  }
+
+  // Changes whenever a page of the table is written or the table is
+  // recreated or dropped, so derived data can tell it is stale
+  uint64_t get_table_version(TableId table_id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return table_versions[table_id];
+  }
 
-  std::shared_ptr<Page> get_page(const std::string &table_name, int page_id);
-  void write_page(const std::string &table_name, std::shared_ptr<Page> page);
+  std::shared_ptr<Page> get_page(TableId table_id, int page_id,
+                                 AccessHint hint = AccessHint::Normal);
+  void write_page(TableId table_id, std::shared_ptr<Page> page);
+
+  // Pinned pages are never chosen for eviction until every pin is released
+  std::shared_ptr<Page> pin_page(TableId table_id, int page_id,
+                                 AccessHint hint = AccessHint::Normal);
+  void unpin_page(TableId table_id, int page_id);
+
+  void create_table(TableId table_id);
+  // Discards the table's cached pages without writing them and removes its
+  // file. Used for temporary tables such as hash join partitions.
+  void drop_table(TableId table_id);
   void flush_all();
+  // Writes the dirty pages of one table, as flush_all() does; they stay
+  // cached
+  void flush(TableId table_id);
+
+  // Asks the background I/O thread to load pages [first_page, first_page +
+  // count) of a table. Pages already resident are skipped, and a request is
+  // dropped if every frame is pinned or holds a page read ahead that no scan
+  // has reached yet when it is served.
+  void prefetch(TableId table_id, int first_page, int count);
+  // Upper bound on how far ahead a sequential scan may read; 0 disables
+  // read-ahead. Defaults to an eighth of the pool, and to one page in pools
+  // under eight pages.
+  void set_readahead_pages(size_t pages);
+  size_t get_readahead_pages() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return readahead_pages;
+  }
+
+  // Pool geometry
+  size_t get_pool_size() const { return pool_pages; }
+  WritePolicy get_write_policy() const { return write_policy; }
+  const char *get_replacement_policy_name() const { return replacer->name(); }
+  size_t get_page_size() const;
+  size_t get_sort_buffer_pages() const { return sort_grant_pages; }
+  size_t get_sort_buffer_bytes() const {
+    return sort_grant_pages * get_page_size();
+  }
 
   // Buffer statistics
-  size_t get_buffer_usage() const { return page_map.size(); }
-  bool is_buffer_full() const { return page_map.size() >= BUFFER_SIZE; }
+  size_t get_buffer_usage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return page_table.size();
+  }
+  bool is_buffer_full() const { return get_buffer_usage() >= pool_pages; }
+  size_t get_hit_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+  }
+  size_t get_miss_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+  }
+  size_t get_prefetch_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return prefetch_count;
+  }
+  double get_hit_rate() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = hit_count + miss_count;
+    return total == 0 ? 0.0 : static_cast<double>(hit_count) / total;
+  }
+  void reset_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    hit_count = miss_count = prefetch_count = 0;
+  }
 };
 
 #endif // BUFFER_MANAGER_H
@@ -0,0 +1,220 @@
+#include "catalog.h"
+#include "disk_manager.h"
+#include "table.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const char *const CATALOG_MAGIC = "SMJ-CATALOG";
+
+// Size and modification time of a file, or false if it cannot be read
+bool file_state(const std::string &filename, uint64_t &size, int64_t &mtime) {
+  std::error_code error;
+  auto file_size = std::filesystem::file_size(filename, error);
+  if (error) {
+    return false;
+  }
+  auto write_time = std::filesystem::last_write_time(filename, error);
+  if (error) {
+    return false;
+  }
+  size = static_cast<uint64_t>(file_size);
+  mtime = static_cast<int64_t>(write_time.time_since_epoch().count());
+  return true;
+}
+
+bool read_value(std::istream &in, const Column &column, Value &value) {
+  std::string text;
+  return static_cast<bool>(in >> std::quoted(text)) &&
+         parse_value(text, column, value);
+}
+
+// Reads one table block after its "table" keyword; false on a malformed
+// block
+bool read_table(std::istream &in, TableInfo &info) {
+  std::string keyword;
+  if (!(in >> std::quoted(info.name) >> keyword >> info.pages) ||
+      keyword != "pages") {
+    return false;
+  }
+  if (!(in >> keyword >> std::quoted(info.sort_column)) || keyword != "sort") {
+    return false;
+  }
+  if (!(in >> keyword >> info.stats.row_count) || keyword != "rows") {
+    return false;
+  }
+  if (!(in >> keyword >> info.stats.row_bytes) || keyword != "bytes") {
+    return false;
+  }
+  if (!(in >> keyword >> std::quoted(info.source) >> info.source_size >>
+        info.source_mtime) ||
+      keyword != "source") {
+    return false;
+  }
+
+  std::vector<Column> columns;
+  while (in >> keyword && keyword == "column") {
+    std::string name, type_name;
+    size_t length;
+    if (!(in >> std::quoted(name) >> type_name >> length)) {
+      return false;
+    }
+    ColumnType type;
+    if (!parse_column_type(type_name, type)) {
+      return false;
+    }
+    columns.emplace_back(name, type, length);
+
+    ColumnStats stats;
+    std::string range;
+    if (!(in >> keyword >> stats.distinct_count >> range) ||
+        keyword != "distinct") {
+      return false;
+    }
+    if (range == "range") {
+      if (!read_value(in, columns.back(), stats.min_value) ||
+          !read_value(in, columns.back(), stats.max_value)) {
+        return false;
+      }
+      stats.has_range = true;
+    } else if (range != "empty") {
+      return false;
+    }
+    info.stats.columns.push_back(stats);
+  }
+  info.schema = Schema(columns);
+  return keyword == "end";
+}
+
+} // namespace
+
+Catalog::Catalog(std::shared_ptr<DiskManager> dm)
+    : disk_manager(std::move(dm)),
+      path(disk_manager->get_data_directory() + "catalog") {
+  load();
+}
+
+void Catalog::load() {
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    return;
+  }
+
+  std::string magic;
+  int version = 0;
+  uint32_t page_size = 0;
+  std::string keyword;
+  if (!(in >> magic >> version >> keyword >> page_size) ||
+      magic != CATALOG_MAGIC || version != FORMAT_VERSION ||
+      keyword != "page_size") {
+    std::cerr << "Warning: Ignoring unreadable catalog " << path << std::endl;
+    return;
+  }
+  if (page_size != disk_manager->get_page_size()) {
+    return;
+  }
+
+  while (in >> keyword) {
+    TableInfo info;
+    if (keyword != "table" || !read_table(in, info)) {
+      std::cerr << "Warning: Ignoring malformed catalog " << path << std::endl;
+      tables.clear();
+      return;
+    }
+    tables[info.name] = std::move(info);
+  }
+}
+
+void Catalog::save() const {
+  // Write a new file and rename it over the old one, so a crash never
+  // leaves a half-written catalog
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::trunc);
+    if (!out.is_open()) {
+      throw std::runtime_error("Cannot write catalog: " + temp_path);
+    }
+
+    out << CATALOG_MAGIC << " " << FORMAT_VERSION << " page_size "
+        << disk_manager->get_page_size() << "\n";
+    for (const auto &[name, info] : tables) {
+      out << "table " << std::quoted(name) << " pages " << info.pages
+          << " sort " << std::quoted(info.sort_column) << " rows "
+          << info.stats.row_count << " bytes " << info.stats.row_bytes << "\n";
+      out << "source " << std::quoted(info.source) << " " << info.source_size
+          << " " << info.source_mtime << "\n";
+      for (size_t i = 0; i < info.schema.size(); ++i) {
+        const Column &column = info.schema[i];
+        const ColumnStats &stats = info.stats.columns[i];
+        out << "column " << std::quoted(column.name) << " "
+            << column_type_name(column.type) << " " << column.length
+            << " distinct " << stats.distinct_count;
+        if (stats.has_range) {
+          out << " range " << std::quoted(to_string(stats.min_value)) << " "
+              << std::quoted(to_string(stats.max_value));
+        } else {
+          out << " empty";
+        }
+        out << "\n";
+      }
+      out << "end\n";
+    }
+    if (!out) {
+      throw std::runtime_error("Cannot write catalog: " + temp_path);
+    }
+  }
+  std::filesystem::rename(temp_path, path);
+}
+
+const TableInfo *Catalog::find(const std::string &name) const {
+  auto it = tables.find(name);
+  return it == tables.end() ? nullptr : &it->second;
+}
+
+void Catalog::record(const Table &table, const std::string &source) {
+  TableInfo info;
+  info.name = table.get_name();
+  info.schema = table.get_schema();
+  info.pages = table.get_total_pages();
+  info.sort_column = table.get_sort_column();
+  if (const TableStats *stats = table.get_stats()) {
+    info.stats = *stats;
+  } else {
+    info.stats.columns.resize(info.schema.size());
+  }
+  info.source = source;
+  if (!source.empty()) {
+    file_state(source, info.source_size, info.source_mtime);
+  }
+  tables[info.name] = std::move(info);
+}
+
+void Catalog::remove(const std::string &name) { tables.erase(name); }
+
+std::shared_ptr<Table>
+Catalog::open_table(const std::string &name, const Schema &expected_schema,
+                    const std::string &source,
+                    std::shared_ptr<BufferManager> buffer_manager) const {
+  const TableInfo *info = find(name);
+  if (!info || info->schema != expected_schema ||
+      disk_manager->get_total_pages(name) != info->pages) {
+    return nullptr;
+  }
+
+  uint64_t size;
+  int64_t mtime;
+  if (info->source != source || !file_state(source, size, mtime) ||
+      size != info->source_size || mtime != info->source_mtime) {
+    return nullptr;
+  }
+
+  auto table = std::make_shared<Table>(name, info->schema, buffer_manager);
+  table->set_total_pages(info->pages);
+  table->set_sort_column(info->sort_column);
+  table->set_stats(std::make_shared<TableStats>(info->stats));
+  return table;
+}
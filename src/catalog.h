@@ -0,0 +1,68 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "schema.h"
+#include "table_stats.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+class BufferManager;
+class DiskManager;
+class Table;
+
+// What the catalog knows about a stored table
+struct TableInfo {
+  std::string name;
+  Schema schema;
+  int pages = 0;
+  std::string sort_column; // Empty when the rows have no known order
+  TableStats stats;
+  // File the table was loaded from, with its size and modification time
+  // at that point, so a changed source forces a reload
+  std::string source;
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+};
+
+// Table metadata kept in <data dir>/catalog next to the table files, so a
+// later run can reopen tables without loading them again. The file is text:
+// a header line with the format version and page size, then one block per
+// table. Strings are quoted.
+//   table "Uva" pages 1 sort "uva_id" rows 75 bytes 2456
+//   source "data/uva.csv" 3856 1718000000000000000
+//   column "uva_id" int64 0 distinct 75 range "0" "74"
+//   end
+// A catalog written with another page size is ignored, since its table files
+// cannot be read either.
+class Catalog {
+private:
+  static const int FORMAT_VERSION = 1;
+
+  std::shared_ptr<DiskManager> disk_manager;
+  std::string path;
+  std::map<std::string, TableInfo> tables;
+
+  void load();
+
+public:
+  explicit Catalog(std::shared_ptr<DiskManager> dm);
+
+  const TableInfo *find(const std::string &name) const;
+  // Records the table's current schema, pages, order and statistics, and
+  // the state of the file it was loaded from
+  void record(const Table &table, const std::string &source);
+  void remove(const std::string &name);
+  void save() const;
+
+  // Reopens a table without reading any page when the catalog entry has the
+  // expected schema, the table file still has the recorded pages and the
+  // source file is unchanged. Returns nullptr otherwise.
+  std::shared_ptr<Table>
+  open_table(const std::string &name, const Schema &expected_schema,
+             const std::string &source,
+             std::shared_ptr<BufferManager> buffer_manager) const;
+};
+
+#endif // CATALOG_H
@@ -1,174 +1,285 @@
 #include "disk_manager.h"
 #include "table.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem>
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
 
 std::atomic<int> DiskManager::in_io_count(0);
 std::atomic<int> DiskManager::out_io_count(0);
 
-DiskManager::DiskManager(const std::string &data_dir)
-    : data_directory(data_dir) {
+namespace {
+
+// On-disk file header, stored in the first FILE_HEADER_SIZE bytes
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t page_size;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == DiskManager::FILE_HEADER_SIZE,
+              "FileHeader must fill the file header exactly");
+
+void put_u16(std::vector<char> &buffer, size_t &pos, size_t value,
+             const char *what) {
+  if (value > UINT16_MAX) {
+    throw std::runtime_error(std::string("Page field too large: ") + what);
+  }
+  uint16_t v = static_cast<uint16_t>(value);
+  std::memcpy(buffer.data() + pos, &v, sizeof(v));
+  pos += sizeof(v);
+}
+
+uint16_t get_u16(const std::vector<char> &buffer, size_t &pos) {
+  if (pos + sizeof(uint16_t) > buffer.size()) {
+    throw std::runtime_error("Corrupt page: read past end of page");
+  }
+  uint16_t v;
+  std::memcpy(&v, buffer.data() + pos, sizeof(v));
+  pos += sizeof(v);
+  return v;
+}
+
+} // namespace
+
+DiskManager::DiskManager(const std::string &data_dir, uint32_t page_size_bytes)
+    : data_directory(data_dir), page_size(page_size_bytes) {
+  if (page_size < MIN_PAGE_SIZE || page_size > MAX_PAGE_SIZE) {
+    throw std::runtime_error("Page size must be between " +
+                             std::to_string(MIN_PAGE_SIZE) + " and " +
+                             std::to_string(MAX_PAGE_SIZE) + " bytes");
+  }
   ensure_data_directory();
 }
 
+DiskManager::OpenFile::~OpenFile() { ::close(fd); }
+
 std::string DiskManager::get_table_filename(const std::string &table_name) {
   return data_directory + table_name + ".dat";
 }
 
+off_t DiskManager::page_offset(int page_id) const {
+  return static_cast<off_t>(FILE_HEADER_SIZE) +
+         static_cast<off_t>(page_id) * page_size;
+}
+
 void DiskManager::ensure_data_directory() {
   std::filesystem::create_directories(data_directory);
 }
 
-std::shared_ptr<Page> DiskManager::read_page(const std::string &table_name,
-                                             int page_id) {
+std::shared_ptr<DiskManager::OpenFile>
+DiskManager::open_file(const std::string &table_name, bool create) {
+  std::lock_guard<std::mutex> lock(files_mutex);
+
+  auto it = open_files.find(table_name);
+  if (it != open_files.end()) {
+    return it->second;
+  }
 
   std::string filename = get_table_filename(table_name);
-  std::ifstream file(filename, std::ios::binary);
+  int fd = ::open(filename.c_str(), create ? (O_RDWR | O_CREAT) : O_RDWR,
+                  0644);
+  if (fd < 0) {
+    if (!create) {
+      return nullptr;
+    }
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  auto file = std::make_shared<OpenFile>(fd);
 
-  if (!file.is_open()) {
-    // File doesn't exist, return empty page
-    return std::make_shared<Page>(page_id);
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    throw std::runtime_error("Cannot stat file: " + filename);
   }
 
-  auto page = std::make_shared<Page>(page_id);
+  if (st.st_size == 0) {
+    write_file_header(fd, filename);
+  } else {
+    validate_file_header(fd, filename);
+  }
 
-  // Calculate file position for this page
-  file.seekg(0, std::ios::end);
-  std::streamsize file_size = file.tellg();
-  file.seekg(0, std::ios::beg);
+  open_files[table_name] = file;
+  return file;
+}
 
-  std::string line;
-  int current_page = 0;
-  int rows_in_current_page = 0;
+int DiskManager::count_pages(int fd) const {
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= FILE_HEADER_SIZE) {
+    return 0;
+  }
 
-  while (std::getline(file, line) && current_page <= page_id) {
-    if (line.empty())
-      continue;
+  // A partially written trailing slot still counts as a page
+  return static_cast<int>((st.st_size - FILE_HEADER_SIZE + page_size - 1) /
+                          page_size);
+}
 
-    if (current_page == page_id) {
-      // Parse the line and add to page
-      std::vector<std::string> columns;
-      std::stringstream ss(line);
-      std::string token;
+void DiskManager::write_file_header(int fd, const std::string &filename) {
+  FileHeader header{FILE_MAGIC, FILE_VERSION, page_size, 0};
+  if (::pwrite(fd, &header, sizeof(header), 0) !=
+      static_cast<ssize_t>(sizeof(header))) {
+    throw std::runtime_error("Cannot write header to file: " + filename);
+  }
+}
 
-      while (std::getline(ss, token, '|')) {
-        columns.push_back(token);
-      }
+void DiskManager::validate_file_header(int fd, const std::string &filename) {
+  FileHeader header;
+  if (::pread(fd, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header)) ||
+      header.magic != FILE_MAGIC) {
+    throw std::runtime_error("Not a table file: " + filename);
+  }
+  if (header.version != FILE_VERSION || header.page_size != page_size) {
+    throw std::runtime_error("Incompatible table file format: " + filename);
+  }
+}
 
-      if (!columns.empty()) {
-        Row row(columns);
-        page->add_row(row);
-      }
+// Page layout: u16 row count, then the rows back to back in the encoding
+// defined by the page's Schema. The rest of the slot is zero.
+void DiskManager::serialize_page(const Page &page, std::vector<char> &buffer,
+                                 size_t offset) const {
+  buffer.resize(std::max(buffer.size(), offset + page_size));
+  std::fill(buffer.begin() + offset, buffer.begin() + offset + page_size, 0);
+  size_t pos = offset;
+  const size_t end = offset + page_size;
+
+  auto require = [&](size_t bytes) {
+    if (pos + bytes > end) {
+      throw std::runtime_error("Page " + std::to_string(page.page_id) +
+                               " does not fit in " +
+                               std::to_string(page_size) + " bytes");
     }
+  };
 
-    rows_in_current_page++;
-    if (rows_in_current_page >= Page::MAX_ROWS) {
-      current_page++;
-      // increments io count for each page read
-      increment_in_io_count();
-      rows_in_current_page = 0;
-    }
-  }
+  require(sizeof(uint16_t));
+  put_u16(buffer, pos, page.rows.size(), "row count");
 
-  file.close();
-  page->dirty = false;
-  return page;
+  // Pages hold their rows already encoded
+  require(page.rows.byte_size());
+  std::copy_n(page.rows.data(), page.rows.byte_size(), buffer.begin() + pos);
 }
 
-void DiskManager::write_page(const std::string &table_name,
-                             std::shared_ptr<Page> page) {
-  increment_out_io_count();
+void DiskManager::deserialize_page(const std::vector<char> &buffer,
+                                   Page &page) const {
+  size_t pos = 0;
+  uint16_t row_count = get_u16(buffer, pos);
+  page.rows.clear();
+
+  for (uint16_t i = 0; i < row_count; ++i) {
+    size_t bytes = page.schema->encoded_row_size(buffer.data() + pos,
+                                                 buffer.size() - pos);
+    page.rows.append(RowRef{buffer.data() + pos, bytes});
+    pos += bytes;
+    page.used_bytes += bytes;
+  }
+}
 
-  std::string filename = get_table_filename(table_name);
+std::shared_ptr<Page>
+DiskManager::read_page(const std::string &table_name,
+                       std::shared_ptr<const Schema> schema, int page_id) {
+  auto page = std::make_shared<Page>(page_id, std::move(schema), page_size);
 
-  std::vector<std::string> all_lines;
+  auto file = open_file(table_name, false);
+  if (!file || page_id >= count_pages(file->fd)) {
+    // File or page doesn't exist, return empty page
+    return page;
+  }
 
-  std::ifstream read_file(filename);
-  if (read_file.is_open()) {
-    std::string line;
-    while (std::getline(read_file, line)) {
-      all_lines.push_back(line);
-    }
-    read_file.close();
+  std::vector<char> buffer(page_size);
+  ssize_t bytes =
+      ::pread(file->fd, buffer.data(), page_size, page_offset(page_id));
+  if (bytes != static_cast<ssize_t>(page_size)) {
+    throw std::runtime_error("Short read of page " + std::to_string(page_id) +
+                             " from " + get_table_filename(table_name));
   }
+  increment_in_io_count();
 
-  int start_line = page->page_id * Page::MAX_ROWS;
+  deserialize_page(buffer, *page);
+  page->dirty = false;
+  return page;
+}
 
-  // Ensure we have enough lines
-  while (all_lines.size() < start_line + Page::MAX_ROWS) {
-    all_lines.push_back("");
+void DiskManager::write_page(const std::string &table_name,
+                             std::shared_ptr<Page> page) {
+  std::vector<char> buffer;
+  serialize_page(*page, buffer, 0);
+
+  auto file = open_file(table_name, true);
+  ssize_t bytes = ::pwrite(file->fd, buffer.data(), page_size,
+                           page_offset(page->page_id));
+  if (bytes != static_cast<ssize_t>(page_size)) {
+    throw std::runtime_error("Cannot write to file: " +
+                             get_table_filename(table_name));
   }
+  increment_out_io_count();
 
-  // Replace lines for this page
-  for (size_t i = 0; i < page->rows.size(); ++i) {
-    std::stringstream ss;
-    const Row &row = page->rows[i];
-
-    for (size_t j = 0; j < row.size(); ++j) {
-      if (j > 0)
-        ss << "|";
-      ss << row[j];
-    }
+  page->dirty = false;
+}
 
-    all_lines[start_line + i] = ss.str();
+void DiskManager::write_pages(const std::string &table_name,
+                              const std::vector<std::shared_ptr<Page>> &pages) {
+  if (pages.empty()) {
+    return;
   }
 
-  // Clear remaining lines in this page
-  for (size_t i = page->rows.size(); i < Page::MAX_ROWS; ++i) {
-    if (start_line + i < all_lines.size()) {
-      all_lines[start_line + i] = "";
+  int first_page_id = pages.front()->page_id;
+  std::vector<char> buffer;
+  buffer.reserve(pages.size() * page_size);
+  for (size_t i = 0; i < pages.size(); ++i) {
+    if (pages[i]->page_id != first_page_id + static_cast<int>(i)) {
+      throw std::runtime_error("write_pages requires consecutive page ids");
     }
+    serialize_page(*pages[i], buffer, i * page_size);
   }
 
-  // Write back to file
-  std::ofstream write_file(filename);
-  if (!write_file.is_open()) {
-    throw std::runtime_error("Cannot write to file: " + filename);
+  auto file = open_file(table_name, true);
+  ssize_t bytes = ::pwrite(file->fd, buffer.data(), buffer.size(),
+                           page_offset(first_page_id));
+  if (bytes != static_cast<ssize_t>(buffer.size())) {
+    throw std::runtime_error("Cannot write to file: " +
+                             get_table_filename(table_name));
   }
 
-  for (const std::string &line : all_lines) {
-    if (!line.empty()) {
-      write_file << line << std::endl;
-    }
+  // I/O is accounted per page, even when written in one call
+  for (const auto &page : pages) {
+    increment_out_io_count();
+    page->dirty = false;
   }
-
-  write_file.close();
-  page->dirty = false;
 }
 
 bool DiskManager::table_file_exists(const std::string &table_name) {
-  std::string filename = get_table_filename(table_name);
-  std::ifstream file(filename);
-  return file.good();
+  return std::filesystem::exists(get_table_filename(table_name));
 }
 
 void DiskManager::create_table_file(const std::string &table_name) {
   std::string filename = get_table_filename(table_name);
-  std::ofstream file(filename);
-  file.close();
-}
-
-int DiskManager::get_total_pages(const std::string &table_name) {
-  std::string filename = get_table_filename(table_name);
-  std::ifstream file(filename);
+  std::lock_guard<std::mutex> lock(files_mutex);
 
-  if (!file.is_open()) {
-    return 0;
+  int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot create file: " + filename);
   }
+  auto file = std::make_shared<OpenFile>(fd);
+  write_file_header(fd, filename);
+  open_files[table_name] = file;
+}
 
-  int line_count = 0;
-  std::string line;
+void DiskManager::remove_table_file(const std::string &table_name) {
+  std::string filename = get_table_filename(table_name);
+  std::lock_guard<std::mutex> lock(files_mutex);
 
-  while (std::getline(file, line)) {
-    if (!line.empty()) {
-      line_count++;
-    }
+  open_files.erase(table_name);
+  std::error_code error;
+  std::filesystem::remove(filename, error);
+  if (error) {
+    throw std::runtime_error("Cannot remove file: " + filename);
   }
+}
 
-  file.close();
-
-  // Calculate number of pages needed
-  return (line_count + Page::MAX_ROWS - 1) / Page::MAX_ROWS;
+int DiskManager::get_total_pages(const std::string &table_name) {
+  auto file = open_file(table_name, false);
+  return file ? count_pages(file->fd) : 0;
 }
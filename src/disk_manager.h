@@ -2,28 +2,81 @@
 #define DISK_MANAGER_H
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
 
 class Page;
+class Schema;
 
+// Table files are binary: a small fixed-size header followed by fixed-size
+// page slots, so page N lives at FILE_HEADER_SIZE + N * page_size.
+// Page reads and writes may be issued from several threads at once.
 class DiskManager {
+public:
+  static constexpr uint32_t DEFAULT_PAGE_SIZE = 4096;
+  static constexpr uint32_t MIN_PAGE_SIZE = 256;
+  static constexpr uint32_t MAX_PAGE_SIZE = 1 << 20;
+  static constexpr uint32_t FILE_HEADER_SIZE = 16;
+  static constexpr uint32_t FILE_MAGIC = 0x504a4d53; // "SMJP"
+  static constexpr uint32_t FILE_VERSION = 2;
+
 private:
+  // Closes the descriptor once the last in-flight I/O using it is done, so a
+  // table can be recreated while another thread is still reading it
+  struct OpenFile {
+    int fd;
+    explicit OpenFile(int descriptor) : fd(descriptor) {}
+    ~OpenFile();
+  };
+
   std::string data_directory;
+  uint32_t page_size;
+  std::mutex files_mutex;
+  std::unordered_map<std::string, std::shared_ptr<OpenFile>> open_files;
   static std::atomic<int> in_io_count;
   static std::atomic<int> out_io_count;
 
   std::string get_table_filename(const std::string &table_name);
+  std::shared_ptr<OpenFile> open_file(const std::string &table_name,
+                                      bool create);
+  int count_pages(int fd) const;
+  void write_file_header(int fd, const std::string &filename);
+  void validate_file_header(int fd, const std::string &filename);
+
+  off_t page_offset(int page_id) const;
+  void serialize_page(const Page &page, std::vector<char> &buffer,
+                      size_t offset) const;
+  void deserialize_page(const std::vector<char> &buffer, Page &page) const;
 
 public:
-  DiskManager(const std::string &data_dir = "data/");
+  DiskManager(const std::string &data_dir = "data/",
+              uint32_t page_size_bytes = DEFAULT_PAGE_SIZE);
+
+  DiskManager(const DiskManager &) = delete;
+  DiskManager &operator=(const DiskManager &) = delete;
 
-  std::shared_ptr<Page> read_page(const std::string &table_name, int page_id);
+  // Pages are decoded with the schema of the table they belong to
+  std::shared_ptr<Page> read_page(const std::string &table_name,
+                                  std::shared_ptr<const Schema> schema,
+                                  int page_id);
   void write_page(const std::string &table_name, std::shared_ptr<Page> page);
+  // Writes pages with consecutive ids starting at pages.front()->page_id
+  // with a single pwrite
+  void write_pages(const std::string &table_name,
+                   const std::vector<std::shared_ptr<Page>> &pages);
 
   bool table_file_exists(const std::string &table_name);
   void create_table_file(const std::string &table_name);
+  // Unlinks the table's file; reads already in flight keep their descriptor
+  void remove_table_file(const std::string &table_name);
   int get_total_pages(const std::string &table_name);
+  uint32_t get_page_size() const { return page_size; }
+  const std::string &get_data_directory() const { return data_directory; }
 
   // I/O operation counters for monitoring purposes
   static int get_in_io_count() { return in_io_count.load(); }
@@ -0,0 +1,64 @@
+#include "distinct_sketch.h"
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+namespace {
+
+// Final mix of splitmix64, so that close values spread over the whole range
+uint64_t mix(uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+} // namespace
+
+uint64_t DistinctSketch::hash_value(const Value &value) {
+  if (const std::string *text = std::get_if<std::string>(&value)) {
+    return mix(std::hash<std::string>()(*text));
+  }
+  if (const double *number = std::get_if<double>(&value)) {
+    uint64_t bits;
+    std::memcpy(&bits, number, sizeof(bits));
+    return mix(bits);
+  }
+  if (const Date *date = std::get_if<Date>(&value)) {
+    return mix(static_cast<uint64_t>(date->days));
+  }
+  return mix(static_cast<uint64_t>(std::get<int64_t>(value)));
+}
+
+void DistinctSketch::add(const Value &value) {
+  uint64_t h = hash_value(value);
+  // Once full, most values hash above every kept one
+  if (hashes.size() == K && h >= *hashes.rbegin()) {
+    return;
+  }
+  if (hashes.insert(h).second && hashes.size() > K) {
+    hashes.erase(std::prev(hashes.end()));
+  }
+}
+
+void DistinctSketch::merge(const DistinctSketch &other) {
+  for (uint64_t h : other.hashes) {
+    if (hashes.size() == K && h >= *hashes.rbegin()) {
+      break;
+    }
+    if (hashes.insert(h).second && hashes.size() > K) {
+      hashes.erase(std::prev(hashes.end()));
+    }
+  }
+}
+
+size_t DistinctSketch::estimate() const {
+  if (hashes.size() < K) {
+    return hashes.size();
+  }
+  // The K-th smallest of n uniform hashes lies near K / n of the range
+  double fraction = std::ldexp(static_cast<double>(*hashes.rbegin()), -64);
+  return static_cast<size_t>(std::llround((K - 1) / fraction));
+}
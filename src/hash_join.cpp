@@ -0,0 +1,293 @@
+#include "hash_join.h"
+#include "buffer_manager.h"
+#include "disk_manager.h"
+#include "join_sink.h"
+#include "sort_key.h"
+#include "spill_table.h"
+#include "table.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+namespace JoinOperations {
+
+namespace {
+
+// Past this many rounds of partitioning a partition is built in memory
+// whatever its size; only heavy duplicate keys get that far
+const int MAX_PARTITION_DEPTH = 3;
+
+// Partitions a build side of build_pages spills to so each fits in
+// memory_pages, or 0 when it fits as a whole. One page of memory is kept as
+// the output buffer of each spilled partition, so k partitions fit when
+// k * M >= B - (M - k).
+size_t spill_partitions(size_t build_pages, size_t memory_pages) {
+  if (build_pages <= memory_pages || memory_pages < 2) {
+    return 0;
+  }
+  size_t partitions =
+      (build_pages - memory_pages + memory_pages - 2) / (memory_pages - 1);
+  return std::clamp<size_t>(partitions, 1, memory_pages - 1);
+}
+
+double estimate_partition_io(double build_pages, double probe_pages,
+                             size_t memory_pages, int depth) {
+  size_t spill_count = 0;
+  if (depth < MAX_PARTITION_DEPTH) {
+    spill_count =
+        spill_partitions(static_cast<size_t>(build_pages), memory_pages);
+  }
+  double io = build_pages + probe_pages;
+  if (spill_count == 0) {
+    return io;
+  }
+  double spilled_share = 1.0 - (memory_pages - spill_count) / build_pages;
+  double build_part = build_pages * spilled_share / spill_count;
+  double probe_part = probe_pages * spilled_share / spill_count;
+  // Spilled pages are written once, then read by the next round
+  io += spill_count * (build_part + probe_part);
+  for (size_t i = 0; i < spill_count; ++i) {
+    io += estimate_partition_io(build_part, probe_part, memory_pages,
+                                depth + 1);
+  }
+  return io;
+}
+
+// FNV-1a over the key bytes, seeded per partitioning round so a partition
+// that is split again spreads over new buckets
+uint64_t hash_key(const std::string &key, int depth) {
+  uint64_t hash = 0xcbf29ce484222325ULL ^ (static_cast<uint64_t>(depth) << 56);
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+struct HashJoinContext {
+  std::shared_ptr<BufferManager> buffer_manager;
+  JoinSink &sink;
+  int build_col_idx;
+  int probe_col_idx;
+  bool build_is_left;
+  // Set when one join column is Int64 and the other Double, so equal
+  // numbers get equal keys
+  bool numeric_as_double;
+  size_t memory_pages;
+  RowArena batch;
+  size_t row_count = 0;
+
+  HashJoinContext(std::shared_ptr<BufferManager> bm, JoinSink &output)
+      : buffer_manager(std::move(bm)), sink(output) {}
+
+  std::string key(const Value &value) const {
+    return hash_join_key(value, numeric_as_double);
+  }
+
+  void emit(RowRef build_row, RowRef probe_row) {
+    if (build_is_left) {
+      batch.append(build_row, probe_row);
+    } else {
+      batch.append(probe_row, build_row);
+    }
+    ++row_count;
+    if (batch.size() >= OUTPUT_BATCH_ROWS) {
+      flush();
+    }
+  }
+
+  void flush() {
+    if (!batch.empty()) {
+      sink.consume(batch);
+      batch.clear();
+    }
+  }
+};
+
+void join_partition(HashJoinContext &ctx, Table &build, Table &probe,
+                    const std::string &spill_prefix, int depth) {
+  const size_t build_pages = build.get_total_pages();
+  size_t spill_count = 0;
+  if (depth < MAX_PARTITION_DEPTH) {
+    spill_count = spill_partitions(build_pages, ctx.memory_pages);
+  }
+
+  // The in-memory partition takes the share of keys that fits in the pages
+  // left after one output buffer per spilled partition
+  const double memory_share =
+      spill_count == 0
+          ? 1.0
+          : static_cast<double>(ctx.memory_pages - spill_count) / build_pages;
+  auto partition_of = [&](const std::string &key) -> size_t {
+    if (spill_count == 0) {
+      return 0;
+    }
+    uint64_t hash = hash_key(key, depth);
+    double unit = static_cast<double>(hash >> 11) * 0x1.0p-53;
+    return unit < memory_share ? 0 : 1 + hash % spill_count;
+  };
+
+  std::vector<std::unique_ptr<SpillTable>> build_spills;
+  std::vector<std::unique_ptr<SpillTable>> probe_spills;
+  for (size_t i = 0; i < spill_count; ++i) {
+    std::string suffix = "_" + std::to_string(i + 1);
+    build_spills.push_back(std::make_unique<SpillTable>(
+        spill_prefix + "_build" + suffix, build.get_schema(),
+        ctx.buffer_manager));
+    probe_spills.push_back(std::make_unique<SpillTable>(
+        spill_prefix + "_probe" + suffix, probe.get_schema(),
+        ctx.buffer_manager));
+  }
+
+  // Build phase. Build rows are copied into one arena; the hash table maps
+  // each key to the first and last of its rows, and next_row chains the
+  // rows of a key in input order.
+  const Schema &build_schema = build.get_schema();
+  const Schema &probe_schema = probe.get_schema();
+  const size_t NO_ROW = SIZE_MAX;
+  RowArena build_rows;
+  std::vector<size_t> next_row;
+  std::unordered_map<std::string, std::pair<size_t, size_t>> hash_table;
+  auto build_iter = build.get_iterator(AccessHint::Sequential);
+  while (build_iter.has_next()) {
+    RowRef row = build_iter.next_ref();
+    std::string key =
+        ctx.key(build_schema.column_value(row, ctx.build_col_idx));
+    size_t partition = partition_of(key);
+    if (partition == 0) {
+      size_t index = build_rows.size();
+      build_rows.append(row);
+      next_row.push_back(NO_ROW);
+      auto [it, inserted] =
+          hash_table.try_emplace(std::move(key), index, index);
+      if (!inserted) {
+        next_row[it->second.second] = index;
+        it->second.second = index;
+      }
+    } else {
+      build_spills[partition - 1]->add(row);
+    }
+  }
+
+  // Probe phase
+  auto probe_iter = probe.get_iterator(AccessHint::Sequential);
+  while (probe_iter.has_next()) {
+    RowRef row = probe_iter.next_ref();
+    std::string key =
+        ctx.key(probe_schema.column_value(row, ctx.probe_col_idx));
+    size_t partition = partition_of(key);
+    if (partition == 0) {
+      auto it = hash_table.find(key);
+      if (it != hash_table.end()) {
+        for (size_t index = it->second.first; index != NO_ROW;
+             index = next_row[index]) {
+          ctx.emit(build_rows[index], row);
+        }
+      }
+    } else {
+      probe_spills[partition - 1]->add(row);
+    }
+  }
+  hash_table.clear();
+
+  std::vector<std::shared_ptr<Table>> build_parts;
+  std::vector<std::shared_ptr<Table>> probe_parts;
+  for (size_t i = 0; i < spill_count; ++i) {
+    build_parts.push_back(build_spills[i]->finish());
+    probe_parts.push_back(probe_spills[i]->finish());
+  }
+  build_spills.clear();
+  probe_spills.clear();
+
+  // Spilled partitions only match their counterpart on the other side
+  for (size_t i = 0; i < spill_count; ++i) {
+    if (build_parts[i]->get_total_pages() > 0 &&
+        probe_parts[i]->get_total_pages() > 0) {
+      join_partition(ctx, *build_parts[i], *probe_parts[i],
+                     spill_prefix + "_" + std::to_string(i + 1), depth + 1);
+    }
+    build_parts[i]->drop();
+    probe_parts[i]->drop();
+  }
+}
+
+} // namespace
+
+std::string hash_join_key(const Value &value, bool numeric_as_double) {
+  if (numeric_as_double && std::holds_alternative<int64_t>(value)) {
+    return SortKey::encode(static_cast<double>(std::get<int64_t>(value)));
+  }
+  return SortKey::encode(value);
+}
+
+bool hash_key_needs_double(ColumnType left_type, ColumnType right_type) {
+  auto numeric = [](ColumnType type) {
+    return type == ColumnType::Int64 || type == ColumnType::Double;
+  };
+  return left_type != right_type && numeric(left_type) && numeric(right_type);
+}
+
+double estimate_hash_join_io(double build_pages, double probe_pages,
+                             size_t memory_pages) {
+  return estimate_partition_io(build_pages, probe_pages,
+                               std::max<size_t>(2, memory_pages), 0);
+}
+
+JoinResult hash_join(std::shared_ptr<Table> left_table,
+                     std::shared_ptr<Table> right_table,
+                     const std::string &left_column,
+                     const std::string &right_column,
+                     std::shared_ptr<BufferManager> buffer_manager,
+                     JoinSink &sink) {
+  JoinResult result;
+  result.algorithm = JoinAlgorithm::Hash;
+  int initial_in_io = DiskManager::get_in_io_count();
+  int initial_out_io = DiskManager::get_out_io_count();
+
+  int left_col_idx = left_table->get_column_index(left_column);
+  int right_col_idx = right_table->get_column_index(right_column);
+
+  if (left_col_idx == -1 || right_col_idx == -1) {
+    throw std::runtime_error("Join column not found in one of the tables");
+  }
+
+  result.result_schema = join_result_schema(*left_table, *right_table);
+  sink.open(result.result_schema);
+
+  HashJoinContext ctx(buffer_manager, sink);
+  ctx.build_is_left =
+      left_table->get_total_pages() <= right_table->get_total_pages();
+  Table &build = ctx.build_is_left ? *left_table : *right_table;
+  Table &probe = ctx.build_is_left ? *right_table : *left_table;
+  ctx.build_col_idx = ctx.build_is_left ? left_col_idx : right_col_idx;
+  ctx.probe_col_idx = ctx.build_is_left ? right_col_idx : left_col_idx;
+
+  ctx.numeric_as_double =
+      hash_key_needs_double(left_table->get_schema()[left_col_idx].type,
+                            right_table->get_schema()[right_col_idx].type);
+  ctx.memory_pages =
+      std::max<size_t>(2, buffer_manager->get_sort_buffer_pages());
+
+  std::cout << "Building hash table on " << build.get_name() << " ("
+            << build.get_total_pages() << " pages), probing with "
+            << probe.get_name() << "..." << std::endl;
+  join_partition(ctx, build, probe, build.get_name() + "_hash", 0);
+  ctx.flush();
+  sink.close();
+
+  result.row_count = ctx.row_count;
+  result.total_io_operations = DiskManager::get_in_io_count() - initial_in_io +
+                               DiskManager::get_out_io_count() - initial_out_io;
+
+  std::cout << "Hash join completed. Result has " << result.row_count
+            << " rows with " << result.total_io_operations
+            << " I/O operations." << std::endl;
+
+  return result;
+}
+
+} // namespace JoinOperations
@@ -0,0 +1,36 @@
+#ifndef HASH_JOIN_H
+#define HASH_JOIN_H
+
+#include "join_operation.h"
+
+namespace JoinOperations {
+
+// Hybrid hash join. The input with fewer pages is the build side. When it
+// fits in the sort grant it is loaded into a hash table and the other input
+// probes it in one pass. Otherwise both inputs are hash partitioned: rows of
+// the first partition stay in memory while the others spill to temporary
+// tables through the buffer manager, and each spilled pair is joined
+// afterwards, partitioning again if it still does not fit.
+// Output rows have the left columns first, like sort_merge_join, but are not
+// ordered by key.
+JoinResult hash_join(std::shared_ptr<Table> left_table,
+                     std::shared_ptr<Table> right_table,
+                     const std::string &left_column,
+                     const std::string &right_column,
+                     std::shared_ptr<BufferManager> buffer_manager,
+                     JoinSink &sink);
+
+// Key under which a join value is hashed. With numeric_as_double, an Int64
+// value gets the key of the equal Double, for joins between the two types.
+std::string hash_join_key(const Value &value, bool numeric_as_double);
+// True when equal numbers in these join column types need numeric_as_double
+bool hash_key_needs_double(ColumnType left_type, ColumnType right_type);
+
+// Page reads and writes hash_join does for inputs of these sizes, output
+// excluded, assuming keys spread evenly over the partitions
+double estimate_hash_join_io(double build_pages, double probe_pages,
+                             size_t memory_pages);
+
+} // namespace JoinOperations
+
+#endif // HASH_JOIN_H
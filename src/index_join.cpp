@@ -0,0 +1,151 @@
+#include "index_join.h"
+#include "bplus_tree.h"
+#include "buffer_manager.h"
+#include "disk_manager.h"
+#include "join_sink.h"
+#include "table.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace JoinOperations {
+
+JoinResult index_nested_loop_join(std::shared_ptr<Table> left_table,
+                                  std::shared_ptr<Table> right_table,
+                                  const std::string &left_column,
+                                  const std::string &right_column,
+                                  const BPlusTree &index,
+                                  std::shared_ptr<BufferManager> buffer_manager,
+                                  JoinSink &sink, const JoinOptions &options) {
+  JoinResult result;
+  result.algorithm = JoinAlgorithm::IndexNestedLoop;
+  int initial_in_io = DiskManager::get_in_io_count();
+  int initial_out_io = DiskManager::get_out_io_count();
+
+  if (left_table->get_column_index(left_column) == -1 ||
+      right_table->get_column_index(right_column) == -1) {
+    throw std::runtime_error("Join column not found in one of the tables");
+  }
+  bool inner_is_left = false;
+  if (!index.covers(*right_table, right_column)) {
+    if (!index.covers(*left_table, left_column)) {
+      throw std::runtime_error("Index on " + index.get_table_name() + "." +
+                               index.get_column() +
+                               " does not cover either join input");
+    }
+    inner_is_left = true;
+  }
+  Table &outer = inner_is_left ? *right_table : *left_table;
+  Table &inner = inner_is_left ? *left_table : *right_table;
+  const std::string &outer_column = inner_is_left ? right_column : left_column;
+  const std::string &inner_column = inner_is_left ? left_column : right_column;
+  const int outer_col_idx = outer.get_column_index(outer_column);
+
+  const ScanSpec &outer_spec =
+      inner_is_left ? options.right_scan : options.left_scan;
+  const ScanSpec &inner_spec =
+      inner_is_left ? options.left_scan : options.right_scan;
+  ScanProjection outer_scan(outer.get_schema(), outer_spec, outer_column);
+  ScanProjection inner_scan(inner.get_schema(), inner_spec, inner_column);
+  const Schema &outer_schema = outer_scan.get_schema();
+  const Schema &inner_schema = inner_scan.get_schema();
+  result.result_schema = inner_is_left
+                             ? join_result_schema(inner_schema, outer_schema)
+                             : join_result_schema(outer_schema, inner_schema);
+  sink.open(result.result_schema);
+
+  std::cout << "Probing index on " << index.get_table_name() << "."
+            << index.get_column() << " (height " << index.get_height()
+            << ") with " << outer.get_name() << " ("
+            << outer.get_total_pages() << " pages)..." << std::endl;
+
+  RowArena batch;
+  std::vector<RowLocation> matches;
+  std::shared_ptr<Page> inner_page; // Last inner page fetched
+  size_t outer_rows = 0;
+  size_t probes = 0;
+
+  auto outer_iter = outer.get_iterator(AccessHint::Sequential);
+  while (outer_iter.has_next()) {
+    RowRef outer_row = outer_iter.next_ref();
+    ++outer_rows;
+    RowRef outer_out;
+    if (!outer_scan.apply(outer_row, outer_out)) {
+      continue;
+    }
+    ++probes;
+    matches.clear();
+    index.lookup(outer.get_schema().column_value(outer_row, outer_col_idx),
+                 matches);
+
+    for (const RowLocation &location : matches) {
+      if (!inner_page || inner_page->page_id != location.page_id) {
+        inner_page = buffer_manager->get_page(inner.get_table_id(),
+                                              location.page_id);
+      }
+      RowRef inner_out;
+      if (!inner_scan.apply(inner_page->rows[location.slot], inner_out)) {
+        continue;
+      }
+      if (inner_is_left) {
+        batch.append(inner_out, outer_out);
+      } else {
+        batch.append(outer_out, inner_out);
+      }
+      ++result.row_count;
+      if (batch.size() >= OUTPUT_BATCH_ROWS) {
+        sink.consume(batch);
+        batch.clear();
+      }
+    }
+  }
+  if (!batch.empty()) {
+    sink.consume(batch);
+  }
+  sink.close();
+
+  result.total_io_operations = DiskManager::get_in_io_count() - initial_in_io +
+                               DiskManager::get_out_io_count() - initial_out_io;
+
+  std::cout << "Index nested-loop join completed. " << probes << " of "
+            << outer_rows << " " << outer.get_name()
+            << " rows probed the index; result has " << result.row_count
+            << " rows with " << result.total_io_operations
+            << " I/O operations." << std::endl;
+
+  return result;
+}
+
+const BPlusTree *find_join_index(const Table &left_table,
+                                 const std::string &left_column,
+                                 const Table &right_table,
+                                 const std::string &right_column,
+                                 const JoinOptions &options) {
+  for (const auto &index : options.indexes) {
+    if (index->covers(right_table, right_column)) {
+      return index.get();
+    }
+  }
+  for (const auto &index : options.indexes) {
+    if (index->covers(left_table, left_column)) {
+      return index.get();
+    }
+  }
+  return nullptr;
+}
+
+double estimate_index_join_io(double outer_pages, double probes,
+                              double matches_per_probe, const BPlusTree &index,
+                              double inner_pages, size_t pool_pages) {
+  const double index_pages = index.get_total_pages();
+  const double inner_nodes = index_pages - index.get_leaf_pages();
+  double io = probes * (index.get_height() + matches_per_probe);
+  if (index_pages + inner_pages + 2 <= pool_pages) {
+    io = std::min(io, index_pages + inner_pages);
+  } else if (inner_nodes <= pool_pages / 2.0) {
+    io = inner_nodes + probes * (1 + matches_per_probe);
+  }
+  return outer_pages + io;
+}
+
+} // namespace JoinOperations
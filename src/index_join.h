@@ -0,0 +1,46 @@
+#ifndef INDEX_JOIN_H
+#define INDEX_JOIN_H
+
+#include "join_operation.h"
+
+namespace JoinOperations {
+
+class BPlusTree;
+
+// Index nested-loop join. The input the index covers on its join column is
+// the inner one; the other is read once in page order and each of its rows
+// looks up its key in the index and fetches the matching inner rows by page
+// and slot. Nothing is sorted or written besides the output. The scans in
+// options apply as in sort_merge_join: outer rows failing a predicate are
+// not looked up, inner rows failing one are skipped, and each side keeps
+// only its listed columns. Output rows have the left columns first and come
+// in the order of the outer input.
+JoinResult index_nested_loop_join(std::shared_ptr<Table> left_table,
+                                  std::shared_ptr<Table> right_table,
+                                  const std::string &left_column,
+                                  const std::string &right_column,
+                                  const BPlusTree &index,
+                                  std::shared_ptr<BufferManager> buffer_manager,
+                                  JoinSink &sink,
+                                  const JoinOptions &options = JoinOptions());
+
+// The first of options.indexes that covers the right input on its join
+// column, else the first covering the left one, or null
+const BPlusTree *find_join_index(const Table &left_table,
+                                 const std::string &left_column,
+                                 const Table &right_table,
+                                 const std::string &right_column,
+                                 const JoinOptions &options);
+
+// Page reads of index_nested_loop_join, output excluded: the outer pages,
+// then for each of `probes` lookups a page per index level and one per
+// matching inner row. When the index and the inner table fit in the pool
+// beside the outer page, each of their pages is read at most once; else
+// the inner nodes are assumed to stay cached if they fit in half the pool.
+double estimate_index_join_io(double outer_pages, double probes,
+                              double matches_per_probe, const BPlusTree &index,
+                              double inner_pages, size_t pool_pages);
+
+} // namespace JoinOperations
+
+#endif // INDEX_JOIN_H
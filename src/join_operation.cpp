@@ -1,21 +1,661 @@
 #include "join_operation.h"
+#include "bloom_filter.h"
 #include "buffer_manager.h"
 #include "disk_manager.h"
+#include "hash_join.h"
+#include "join_sink.h"
+#include "sorted_table_cache.h"
+#include "sort_key.h"
+#include "spill_table.h"
 #include "table.h"
+#include "table_stats.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <queue>
 #include <random>
-#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <variant>
 
 namespace JoinOperations {
 
+namespace {
+
+// Numbers the projected sorted copies made by external_sort
+std::atomic<unsigned> projected_copies(0);
+
+// A run record is the row's normalized sort key followed by the row in the
+// table's binary encoding, each prefixed by its u32 length. Sorting and
+// merging only compare keys; row bytes are copied through unchanged.
+struct RunRecord {
+  SortKey::Normalized key;
+  std::string row;
+};
+
+void write_bytes(std::ofstream &out, const std::string &bytes) {
+  uint32_t length = static_cast<uint32_t>(bytes.size());
+  out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+  out.write(bytes.data(), length);
+}
+
+bool read_bytes(std::ifstream &in, std::string &bytes) {
+  uint32_t length;
+  if (!in.read(reinterpret_cast<char *>(&length), sizeof(length))) {
+    return false;
+  }
+  bytes.resize(length);
+  if (!in.read(bytes.data(), length)) {
+    throw std::runtime_error("Truncated run file");
+  }
+  return true;
+}
+
+void write_run_record(std::ofstream &out, const RunRecord &record) {
+  write_bytes(out, record.key.bytes);
+  write_bytes(out, record.row);
+}
+
+// Reuses the record's buffers, so a merge reading into the same record
+// does not allocate once it has seen its largest row
+bool read_run_record(std::ifstream &in, RunRecord &record) {
+  if (!read_bytes(in, record.key.bytes)) {
+    return false;
+  }
+  record.key.head = SortKey::prefix(record.key.bytes);
+  if (!read_bytes(in, record.row)) {
+    throw std::runtime_error("Truncated run file");
+  }
+  return true;
+}
+
+// Tournament tree over k sorted inputs. Internal nodes hold the loser of
+// the match played there and node 0 the overall winner, so replacing the
+// winner replays a single leaf-to-root path: about log2(k) comparisons.
+class LoserTree {
+private:
+  struct Source {
+    std::ifstream stream;
+    RunRecord record;
+    bool exhausted = false;
+  };
+
+  std::vector<Source> sources;
+  std::vector<size_t> tree;
+
+  // Exhausted inputs lose every match; ties go to the earlier run
+  bool beats(size_t a, size_t b) const {
+    if (sources[a].exhausted || sources[b].exhausted) {
+      return !sources[a].exhausted;
+    }
+    if (sources[a].record.key < sources[b].record.key) {
+      return true;
+    }
+    return !(sources[b].record.key < sources[a].record.key) && a < b;
+  }
+
+  size_t build(size_t node) {
+    if (node >= sources.size()) {
+      return node - sources.size();
+    }
+    size_t left = build(2 * node);
+    size_t right = build(2 * node + 1);
+    if (beats(left, right)) {
+      tree[node] = right;
+      return left;
+    }
+    tree[node] = left;
+    return right;
+  }
+
+  void advance(size_t source) {
+    sources[source].exhausted =
+        !read_run_record(sources[source].stream, sources[source].record);
+  }
+
+public:
+  explicit LoserTree(const std::vector<std::string> &run_files)
+      : sources(run_files.size()), tree(std::max<size_t>(1, run_files.size())) {
+    for (size_t i = 0; i < sources.size(); ++i) {
+      sources[i].stream.open(run_files[i], std::ios::binary);
+      if (!sources[i].stream.is_open()) {
+        throw std::runtime_error("Cannot open run file: " + run_files[i]);
+      }
+      advance(i);
+    }
+    if (!sources.empty()) {
+      tree[0] = build(1);
+    }
+  }
+
+  bool empty() const { return sources.empty() || sources[tree[0]].exhausted; }
+  const RunRecord &top() const { return sources[tree[0]].record; }
+
+  // Replaces the winner with the next record of its run and replays its path
+  void pop() {
+    size_t winner = tree[0];
+    advance(winner);
+    for (size_t node = (winner + sources.size()) / 2; node > 0; node /= 2) {
+      if (beats(tree[node], winner)) {
+        std::swap(tree[node], winner);
+      }
+    }
+    tree[0] = winner;
+  }
+};
+
+void merge_run_files(const std::vector<std::string> &inputs,
+                     const std::string &output_file) {
+  LoserTree tree(inputs);
+  std::ofstream output(output_file, std::ios::binary);
+  while (!tree.empty()) {
+    write_run_record(output, tree.top());
+    tree.pop();
+  }
+}
+
+// Replacement selection: records wait in a min-heap ordered by (run, key),
+// bounded by a byte budget. A record whose key is smaller than the last one
+// written cannot join the current run and is tagged for the next one. Runs
+// average twice the budget on random input, and sorted input produces a
+// single run.
+class RunGenerator {
+private:
+  struct HeapEntry {
+    int run;
+    RunRecord record;
+  };
+
+  static bool heap_cmp(const HeapEntry &a, const HeapEntry &b) {
+    if (a.run != b.run) {
+      return a.run > b.run;
+    }
+    return a.record.key > b.record.key;
+  }
+  static size_t record_bytes(const RunRecord &record) {
+    return record.key.bytes.size() + record.row.size();
+  }
+
+  const Schema &schema;
+  int sort_column_index;
+  size_t budget_bytes;
+  std::string name_prefix;
+
+  std::vector<HeapEntry> heap;
+  size_t heap_bytes = 0;
+  int current_run = -1;
+  SortKey::Normalized last_key;
+  std::ofstream run_file;
+  std::vector<std::string> run_files;
+
+  void emit_min() {
+    std::pop_heap(heap.begin(), heap.end(), heap_cmp);
+    HeapEntry entry = std::move(heap.back());
+    heap.pop_back();
+    heap_bytes -= record_bytes(entry.record);
+
+    if (entry.run != current_run) {
+      // Start the next sorted run
+      if (run_file.is_open()) {
+        run_file.close();
+      }
+      current_run = entry.run;
+      std::string run_filename = generate_temp_filename(
+          name_prefix + "_" + std::to_string(current_run));
+      run_file.open(run_filename, std::ios::binary);
+      run_files.push_back(run_filename);
+    }
+
+    write_run_record(run_file, entry.record);
+    last_key = std::move(entry.record.key);
+  }
+
+public:
+  RunGenerator(const Schema &table_schema, int column_index, size_t budget,
+               std::string prefix)
+      : schema(table_schema), sort_column_index(column_index),
+        budget_bytes(budget), name_prefix(std::move(prefix)) {}
+
+  // The key is encoded once here; the budget covers key and row bytes. The
+  // row is already encoded and is copied as it is.
+  void add(RowRef row) {
+    RunRecord record;
+    record.key = SortKey::Normalized(
+        SortKey::encode(schema.column_value(row, sort_column_index)));
+    record.row.assign(row.data, row.size);
+
+    size_t bytes = record_bytes(record);
+    while (!heap.empty() && heap_bytes + bytes > budget_bytes) {
+      emit_min();
+    }
+
+    int run = current_run;
+    if (current_run < 0) {
+      run = 0;
+    } else if (record.key < last_key) {
+      run = current_run + 1;
+    }
+    heap_bytes += bytes;
+    heap.push_back({run, std::move(record)});
+    std::push_heap(heap.begin(), heap.end(), heap_cmp);
+  }
+
+  // Drains the heap and returns the run files written
+  std::vector<std::string> finish() {
+    while (!heap.empty()) {
+      emit_min();
+    }
+    if (run_file.is_open()) {
+      run_file.close();
+    }
+    return std::move(run_files);
+  }
+};
+
+// Bounded hand-off of row batches from the scanning thread to one worker
+class BatchQueue {
+private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<RowArena> batches;
+  size_t capacity;
+  bool closed = false;
+
+public:
+  explicit BatchQueue(size_t max_batches) : capacity(max_batches) {}
+
+  void push(RowArena batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return batches.size() < capacity; });
+    batches.push_back(std::move(batch));
+    cv.notify_all();
+  }
+
+  bool pop(RowArena &batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return closed || !batches.empty(); });
+    if (batches.empty()) {
+      return false;
+    }
+    batch = std::move(batches.front());
+    batches.pop_front();
+    cv.notify_all();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    cv.notify_all();
+  }
+};
+
+// Sequential scan of a sorted table from a start position, ending before
+// the first row whose key reaches `upper` (or at the end when null)
+class RangeCursor {
+private:
+  Table::Iterator iter;
+  const Schema &schema;
+  int column;
+  const Value *upper;
+  Value key_value;
+
+public:
+  RowRef row; // Valid until the next advance()
+  bool valid = false;
+
+  RangeCursor(Table &table, int column_index, std::pair<int, size_t> start,
+              const Value *upper_bound)
+      : iter(&table, start.first, start.second, AccessHint::Sequential),
+        schema(table.get_schema()), column(column_index), upper(upper_bound) {
+    advance();
+  }
+
+  const Value &key() const { return key_value; }
+  const Schema &get_schema() const { return schema; }
+  size_t skipped_pages() const { return iter.get_skipped_pages(); }
+
+  // Advances to the first row whose key is not below `key`, passing over
+  // pages that the zone map shows hold only smaller keys without reading
+  // them
+  void seek(const Value &key) {
+    iter.skip_below(column, key);
+    advance();
+    while (valid && compare_values(key_value, key) < 0) {
+      advance();
+    }
+  }
+
+  void advance() {
+    valid = iter.has_next();
+    if (valid) {
+      row = iter.next_ref();
+      key_value = schema.column_value(row, column);
+      valid = !upper || compare_values(key_value, *upper) < 0;
+    }
+  }
+};
+
+// Duplicate key groups that outgrow memory are moved to temporary tables
+struct SkewSpill {
+  std::shared_ptr<BufferManager> buffer_manager;
+  size_t group_bytes; // Memory for the rows of one side of a group
+  std::string name_prefix;
+  MergeStats stats;
+
+  SkewSpill(std::shared_ptr<BufferManager> bm, size_t bytes,
+            std::string prefix)
+      : buffer_manager(std::move(bm)), group_bytes(bytes),
+        name_prefix(std::move(prefix)) {}
+};
+
+// Gathers the rows of the cursor's key group into rows, adding their count
+// to matched. Once they pass skew.group_bytes they move to a spill table,
+// which is returned; otherwise returns null.
+std::shared_ptr<Table> collect_group(RangeCursor &cursor, const Value &key,
+                                     RowArena &rows, SkewSpill &skew,
+                                     const std::string &side,
+                                     size_t &matched) {
+  rows.clear();
+  std::unique_ptr<SpillTable> spill;
+  while (cursor.valid && compare_values(cursor.key(), key) == 0) {
+    if (!spill && rows.byte_size() + cursor.row.size > skew.group_bytes) {
+      spill = std::make_unique<SpillTable>(skew.name_prefix + "_" + side,
+                                           cursor.get_schema(),
+                                           skew.buffer_manager);
+      for (size_t i = 0; i < rows.size(); ++i) {
+        spill->add(rows[i]);
+      }
+      rows.clear();
+    }
+    if (spill) {
+      spill->add(cursor.row);
+    } else {
+      rows.append(cursor.row);
+    }
+    matched++;
+    cursor.advance();
+  }
+  return spill ? spill->finish() : nullptr;
+}
+
+// Joins a key group with at least one side spilled. When the right side
+// fits in memory, each left row meets all of it, as in memory. Otherwise a
+// block nested loop takes the left side in blocks of block_bytes and
+// rescans the right spill table for each block, emitting block by block.
+// The left spill is read with unpinned get_page calls, so besides the two
+// cursors only the right scan holds a frame and a four-frame pool still
+// has one left for the spill and sink writes.
+template <typename Emit>
+void join_spilled_group(const RowArena &left_rows, Table *left_spill,
+                        const RowArena &right_rows, Table *right_spill,
+                        size_t block_bytes, Emit &emit) {
+  if (!right_spill) {
+    for (int p = 0; p < left_spill->get_total_pages(); ++p) {
+      auto page = left_spill->get_page(p);
+      for (size_t l = 0; l < page->rows.size(); ++l) {
+        for (size_t r = 0; r < right_rows.size(); ++r) {
+          emit(page->rows[l], right_rows[r]);
+        }
+      }
+    }
+    return;
+  }
+
+  auto right_iter = right_spill->get_iterator(AccessHint::Sequential);
+  auto scan_right = [&](const RowArena &block) {
+    right_iter.reset();
+    while (right_iter.has_next()) {
+      RowRef r_row = right_iter.next_ref();
+      for (size_t l = 0; l < block.size(); ++l) {
+        emit(block[l], r_row);
+      }
+    }
+  };
+
+  if (!left_spill) {
+    scan_right(left_rows);
+    return;
+  }
+  RowArena block;
+  for (int p = 0; p < left_spill->get_total_pages(); ++p) {
+    auto page = left_spill->get_page(p);
+    for (size_t l = 0; l < page->rows.size(); ++l) {
+      block.append(page->rows[l]);
+    }
+    if (block.byte_size() >= block_bytes) {
+      scan_right(block);
+      block.clear();
+    }
+  }
+  if (!block.empty()) {
+    scan_right(block);
+  }
+}
+
+// Merges two cursors over sorted inputs, calling emit(left, right) for every
+// pair of rows with equal keys, left-major within each key group that fits
+// in memory. Returns the number of pairs emitted. Key groups are copied into
+// arenas that are reused from group to group; a group too large for
+// skew.group_bytes is spilled and joined by join_spilled_group.
+template <typename Emit>
+size_t merge_join_range(RangeCursor &left, RangeCursor &right,
+                        SkewSpill &skew, Emit &&emit) {
+  RowArena left_matches, right_matches;
+  size_t emitted = 0;
+  auto counted_emit = [&](RowRef l_row, RowRef r_row) {
+    emit(l_row, r_row);
+    ++emitted;
+  };
+
+  while (left.valid && right.valid) {
+    int cmp = compare_values(left.key(), right.key());
+    if (cmp < 0) {
+      left.seek(right.key());
+      continue;
+    }
+    if (cmp > 0) {
+      right.seek(left.key());
+      continue;
+    }
+
+    // Collect the rows of both sides sharing this join value
+    Value join_value = left.key();
+    auto left_spill = collect_group(left, join_value, left_matches, skew,
+                                    "left", skew.stats.left_matched);
+    auto right_spill = collect_group(right, join_value, right_matches, skew,
+                                     "right", skew.stats.right_matched);
+
+    if (!left_spill && !right_spill) {
+      for (size_t l = 0; l < left_matches.size(); ++l) {
+        for (size_t r = 0; r < right_matches.size(); ++r) {
+          counted_emit(left_matches[l], right_matches[r]);
+        }
+      }
+      continue;
+    }
+
+    skew.stats.spilled_groups++;
+    join_spilled_group(left_matches, left_spill.get(), right_matches,
+                       right_spill.get(), skew.group_bytes, counted_emit);
+    if (left_spill) {
+      left_spill->drop();
+    }
+    if (right_spill) {
+      right_spill->drop();
+    }
+  }
+  skew.stats.skipped_pages += left.skipped_pages() + right.skipped_pages();
+  return emitted;
+}
+
+// Position of the first row whose key is not less than `key`, found by a
+// binary search over the first keys of the pages
+std::pair<int, size_t> seek_sorted(Table &table, int column,
+                                   const Value &key) {
+  const Schema &schema = table.get_schema();
+  auto key_less = [&](RowRef row) {
+    return compare_values(schema.column_value(row, column), key) < 0;
+  };
+
+  // Zones answer from memory whether a page starts before key, and whether
+  // the page before lo ends before it; pages without one are read
+  auto starts_before = [&](int page_id) {
+    if (const PageZone *zone = table.get_zone(column, page_id)) {
+      return !zone->has_rows || compare_values(zone->min_value, key) < 0;
+    }
+    auto page = table.get_page(page_id);
+    return page->rows.empty() || key_less(page->rows.front());
+  };
+
+  int lo = 0;
+  int hi = table.get_total_pages();
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (starts_before(mid)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // Every page from lo on starts at or after key; the answer may still be
+  // inside the page before
+  if (lo == 0) {
+    return {0, 0};
+  }
+  const PageZone *zone = table.get_zone(column, lo - 1);
+  if (zone && (!zone->has_rows || compare_values(zone->max_value, key) < 0)) {
+    return {lo, 0};
+  }
+  auto page = table.get_page(lo - 1);
+  size_t first = 0;
+  size_t last = page->rows.size();
+  while (first < last) {
+    size_t mid = first + (last - first) / 2;
+    if (key_less(page->rows[mid])) {
+      first = mid + 1;
+    } else {
+      last = mid;
+    }
+  }
+  if (first == page->rows.size()) {
+    return {lo, 0};
+  }
+  return {lo - 1, first};
+}
+
+// Picks up to partitions - 1 increasing splitter keys from the first keys
+// of evenly spaced pages of both sorted inputs
+std::vector<Value> choose_splitters(Table &left, int left_column,
+                                    Table &right, int right_column,
+                                    size_t partitions) {
+  const size_t SAMPLES_PER_PARTITION = 8;
+  auto less = [](const Value &a, const Value &b) {
+    return compare_values(a, b) < 0;
+  };
+
+  std::vector<Value> samples;
+  auto sample = [&](Table &table, int column) {
+    size_t pages = static_cast<size_t>(table.get_total_pages());
+    size_t count = std::min(pages, SAMPLES_PER_PARTITION * partitions);
+    for (size_t i = 0; i < count; ++i) {
+      int page_id = static_cast<int>(i * pages / count);
+      // A zone gives the first key of the page without reading it
+      if (const PageZone *zone = table.get_zone(column, page_id)) {
+        if (zone->has_rows) {
+          samples.push_back(zone->min_value);
+        }
+        continue;
+      }
+      auto page = table.get_page(page_id);
+      if (!page->rows.empty()) {
+        samples.push_back(
+            table.get_schema().column_value(page->rows.front(), column));
+      }
+    }
+  };
+  sample(left, left_column);
+  sample(right, right_column);
+  std::sort(samples.begin(), samples.end(), less);
+
+  // Equal keys always share a range, so repeated splitters are dropped
+  std::vector<Value> splitters;
+  for (size_t j = 1; j < partitions && !samples.empty(); ++j) {
+    const Value &candidate = samples[j * samples.size() / partitions];
+    const Value &previous = splitters.empty() ? samples.front()
+                                              : splitters.back();
+    if (less(previous, candidate)) {
+      splitters.push_back(candidate);
+    }
+  }
+  return splitters;
+}
+
+// Bloom filter over the join keys of the rows of table that pass the
+// predicates of scan. It is sized from the column's distinct count when the
+// table has statistics, and otherwise from its pages, each taken to hold as
+// many rows as the first; that page is then read again from the pool.
+std::unique_ptr<BloomFilter> build_key_filter(Table &table,
+                                              const std::string &column,
+                                              const ScanSpec &scan,
+                                              bool numeric_as_double) {
+  ScanSpec predicates;
+  predicates.predicates = scan.predicates;
+  ScanProjection projection(table.get_schema(), predicates, column);
+  const int key = table.get_column_index(column);
+
+  size_t expected_keys = 0;
+  if (const TableStats *stats = table.get_stats()) {
+    expected_keys = stats->columns[key].distinct_count;
+  } else if (table.get_total_pages() > 0) {
+    expected_keys = table.get_page(0)->rows.size() * table.get_total_pages();
+  }
+
+  auto filter = std::make_unique<BloomFilter>(
+      expected_keys, BloomFilter::DEFAULT_BITS_PER_KEY, numeric_as_double);
+  auto iter = table.get_iterator(AccessHint::Sequential);
+  RowRef kept;
+  while (iter.has_next()) {
+    RowRef row = iter.next_ref();
+    if (projection.apply(row, kept)) {
+      filter->add(table.get_schema().column_value(row, key));
+    }
+  }
+  return filter;
+}
+
+} // namespace
+
 JoinResult sort_merge_join(std::shared_ptr<Table> left_table,
                            std::shared_ptr<Table> right_table,
                            const std::string &left_column,
                            const std::string &right_column,
-                           std::shared_ptr<BufferManager> buffer_manager) {
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           const JoinOptions &options) {
+  CollectSink sink;
+  JoinResult result =
+      sort_merge_join(left_table, right_table, left_column, right_column,
+                      buffer_manager, sink, options);
+  result.result_rows = std::move(sink.rows);
+  return result;
+}
+
+JoinResult sort_merge_join(std::shared_ptr<Table> left_table,
+                           std::shared_ptr<Table> right_table,
+                           const std::string &left_column,
+                           const std::string &right_column,
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           JoinSink &sink, const JoinOptions &options) {
 
   JoinResult result;
   int initial_in_io = DiskManager::get_in_io_count();
@@ -31,166 +671,355 @@ JoinResult sort_merge_join(std::shared_ptr<Table> left_table,
 
   // Phase 1: Sort both tables
   std::cout << "Phase 1: Sorting tables..." << std::endl;
-  auto sorted_left = external_sort(left_table, left_column, buffer_manager);
-  auto sorted_right = external_sort(right_table, right_column, buffer_manager);
+  ScanSpec left_scan = options.left_scan;
+  ScanSpec right_scan = options.right_scan;
+  auto needs_sort = [&](const Table &table, const std::string &column,
+                        const ScanSpec &scan) {
+    return !scan.empty() ||
+           (table.get_sort_column() != column &&
+            !(options.sorted_cache &&
+              options.sorted_cache->contains(table, column)));
+  };
+
+  // The filter is built on the input with fewer pages and applied to the
+  // other one, the probe side, as its runs are generated
+  std::unique_ptr<BloomFilter> key_filter;
+  const bool filter_left =
+      left_table->get_total_pages() > right_table->get_total_pages();
+  Table &build_table = filter_left ? *right_table : *left_table;
+  Table &probe_table = filter_left ? *left_table : *right_table;
+  const std::string &build_column = filter_left ? right_column : left_column;
+  ScanSpec &probe_scan = filter_left ? left_scan : right_scan;
+  if (options.bloom_filter &&
+      needs_sort(probe_table, filter_left ? left_column : right_column,
+                 probe_scan)) {
+    key_filter = build_key_filter(
+        build_table, build_column,
+        filter_left ? right_scan : left_scan,
+        hash_key_needs_double(left_table->get_schema()[left_col_idx].type,
+                              right_table->get_schema()[right_col_idx].type));
+    probe_scan.key_filter = key_filter.get();
+  }
+
+  auto sort_input = [&](std::shared_ptr<Table> table,
+                        const std::string &column, const ScanSpec &scan) {
+    if (!scan.empty()) {
+      return external_sort(table, column, buffer_manager, options, scan);
+    }
+    if (table->get_sort_column() == column) {
+      std::cout << table->get_name() << " is already sorted on " << column
+                << std::endl;
+      return table;
+    }
+    if (options.sorted_cache) {
+      if (auto cached = options.sorted_cache->find(*table, column)) {
+        std::cout << "Reusing " << cached->get_name() << std::endl;
+        return cached;
+      }
+    }
+    auto sorted = external_sort(table, column, buffer_manager, options);
+    if (options.sorted_cache && sorted != table) {
+      options.sorted_cache->insert(*table, column, sorted);
+    }
+    return sorted;
+  };
+  auto sorted_left = sort_input(left_table, left_column, left_scan);
+  auto sorted_right = sort_input(right_table, right_column, right_scan);
+  // A projected copy may have moved the join column
+  left_col_idx = sorted_left->get_column_index(left_column);
+  right_col_idx = sorted_right->get_column_index(right_column);
 
   // Phase 2: Merge join
   std::cout << "Phase 2: Performing merge join..." << std::endl;
 
-  // Create result column names
-  for (const std::string &col : left_table->get_column_names()) {
-    result.result_columns.push_back("left_" + col);
+  result.result_schema = join_result_schema(*sorted_left, *sorted_right);
+  sink.open(result.result_schema);
+
+  // Perform merge join. Each range worker pins one page per input, and one
+  // more for the right spill while it joins a spilled key group; the left
+  // spill is read unpinned. One frame stays unpinned for spill and output
+  // pages, which bounds how many ranges can run at once.
+  const size_t partitions = std::max<size_t>(
+      1, std::min(options.join_threads,
+                  (buffer_manager->get_pool_size() - 1) / 3));
+  if (partitions < options.join_threads) {
+    std::cerr << "Warning: Merging " << partitions << " of the "
+              << options.join_threads << " key ranges asked for; each pins 3 "
+              << "of the " << buffer_manager->get_pool_size()
+              << " buffer pages" << std::endl;
   }
-  for (const std::string &col : right_table->get_column_names()) {
-    result.result_columns.push_back("right_" + col);
+  // The sort grant is free again once both inputs are sorted; each range
+  // gets a share of it for the two sides of its current key group
+  const size_t group_bytes =
+      std::max(buffer_manager->get_page_size(),
+               buffer_manager->get_sort_buffer_bytes() / (2 * partitions));
+
+  MergeStats merge_stats;
+  if (partitions == 1) {
+    RangeCursor left(*sorted_left, left_col_idx, {0, 0}, nullptr);
+    RangeCursor right(*sorted_right, right_col_idx, {0, 0}, nullptr);
+    SkewSpill skew(buffer_manager, group_bytes,
+                   sorted_left->get_name() + "_skew");
+    RowArena batch;
+    auto emit = [&](RowRef l, RowRef r) {
+      batch.append(l, r);
+      if (batch.size() >= OUTPUT_BATCH_ROWS) {
+        sink.consume(batch);
+        batch.clear();
+      }
+    };
+    result.row_count = merge_join_range(left, right, skew, emit);
+    if (!batch.empty()) {
+      sink.consume(batch);
+    }
+    merge_stats = skew.stats;
+  } else {
+    result.row_count = parallel_merge_join(
+        *sorted_left, left_col_idx, *sorted_right, right_col_idx, partitions,
+        options.ordered_output, sink, buffer_manager, group_bytes,
+        merge_stats);
   }
+  sink.close();
+  result.spilled_groups = merge_stats.spilled_groups;
 
-  // Perform merge join
-  auto left_iter = sorted_left->get_iterator();
-  auto right_iter = sorted_right->get_iterator();
+  // Projected copies only serve this join
+  if (!left_scan.empty()) {
+    sorted_left->drop();
+  }
+  if (!right_scan.empty()) {
+    sorted_right->drop();
+  }
 
-  Row left_row, right_row;
-  bool left_valid = false, right_valid = false;
+  result.total_io_operations = DiskManager::get_in_io_count() - initial_in_io +
+                               DiskManager::get_out_io_count() - initial_out_io;
 
-  // Get first rows
-  if (left_iter.has_next()) {
-    left_row = left_iter.next();
-    left_valid = true;
+  std::cout << "Join completed. Result has " << result.row_count
+            << " rows with " << result.total_io_operations << " I/O operations."
+            << "In I/O: " << DiskManager::get_in_io_count()
+            << ", Out I/O: " << DiskManager::get_out_io_count() << "."
+            << std::endl;
+  if (result.spilled_groups > 0) {
+    std::cout << "Spilled " << result.spilled_groups
+              << " duplicate key groups larger than " << group_bytes
+              << " bytes" << std::endl;
   }
-  if (right_iter.has_next()) {
-    right_row = right_iter.next();
-    right_valid = true;
+  if (merge_stats.skipped_pages > 0) {
+    std::cout << "Zone maps skipped " << merge_stats.skipped_pages
+              << " pages" << std::endl;
   }
 
-  while (left_valid && right_valid) {
-    int cmp = compare_values(left_row[left_col_idx], right_row[right_col_idx]);
+  if (key_filter) {
+    // Probe rows that passed the filter but met no row of the build side
+    // are its false positives; the rows it rejected are the true negatives
+    const size_t rejected = key_filter->get_rejection_count();
+    const size_t passed = key_filter->get_probe_count() - rejected;
+    const size_t matched = filter_left ? merge_stats.left_matched
+                                       : merge_stats.right_matched;
+    const size_t false_positives = passed > matched ? passed - matched : 0;
+    result.bloom_rows_eliminated = rejected;
+    if (false_positives + rejected > 0) {
+      result.bloom_false_positive_rate =
+          static_cast<double>(false_positives) / (false_positives + rejected);
+    }
+    std::cout << "Bloom filter on " << build_table.get_name() << "."
+              << build_column << " (" << key_filter->get_key_count()
+              << " keys, " << key_filter->get_bit_count() << " bits, "
+              << key_filter->get_hash_count() << " hashes) eliminated "
+              << rejected << " of " << key_filter->get_probe_count() << " "
+              << probe_table.get_name() << " rows, false-positive rate "
+              << std::fixed << std::setprecision(1)
+              << result.bloom_false_positive_rate * 100 << "% (expected "
+              << key_filter->expected_false_positive_rate() * 100 << "%)"
+              << std::defaultfloat << std::endl;
+  }
 
-    if (cmp == 0) {
-      // Match found - handle potential duplicates
-      std::vector<Row> left_matches, right_matches;
-      std::string join_value = left_row[left_col_idx];
+  return result;
+}
 
-      // Collect all left rows with same join value
-      left_matches.push_back(left_row);
-      while (left_iter.has_next()) {
-        Row next_left = left_iter.next();
-        if (compare_values(next_left[left_col_idx], join_value) == 0) {
-          left_matches.push_back(next_left);
-        } else {
-          left_row = next_left;
-          break;
-        }
+size_t parallel_merge_join(Table &sorted_left, int left_col_idx,
+                           Table &sorted_right, int right_col_idx,
+                           size_t partitions, bool ordered_output,
+                           JoinSink &sink,
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           size_t group_bytes, MergeStats &stats) {
+  std::vector<Value> splitters = choose_splitters(
+      sorted_left, left_col_idx, sorted_right, right_col_idx, partitions);
+  const size_t ranges = splitters.size() + 1;
+
+  // Sink calls are serialized. For ordered output only range next_range may
+  // emit; later ranges park their rows in a spill table, holding one page
+  // in memory, and the sink reads it back once every earlier range is done.
+  const Schema output_schema = join_result_schema(sorted_left, sorted_right);
+  std::mutex sink_mutex;
+  std::vector<std::unique_ptr<SpillTable>> parked(ranges);
+  std::vector<bool> finished(ranges, false);
+  size_t next_range = 0;
+
+  // Parked pages are read unpinned, so replaying needs no frame of its own
+  auto replay = [&](size_t p) {
+    if (!parked[p]) {
+      return;
+    }
+    std::shared_ptr<Table> rows = parked[p]->finish();
+    for (int page_id = 0; page_id < rows->get_total_pages(); ++page_id) {
+      sink.consume(rows->get_page(page_id)->rows);
+    }
+    rows->drop();
+    parked[p].reset();
+  };
+  auto deliver = [&](size_t p, RowArena &batch) {
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    if (ordered_output && p != next_range) {
+      if (!parked[p]) {
+        parked[p] = std::make_unique<SpillTable>(
+            sorted_left.get_name() + "_parked_" + std::to_string(p),
+            output_schema, buffer_manager);
       }
-      if (!left_iter.has_next() &&
-          compare_values(left_matches.back()[left_col_idx], join_value) == 0) {
-        left_valid = false;
+      for (size_t i = 0; i < batch.size(); ++i) {
+        parked[p]->add(batch[i]);
       }
+    } else {
+      replay(p);
+      sink.consume(batch);
+    }
+    batch.clear();
+  };
+  auto finish = [&](size_t p) {
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    finished[p] = true;
+    while (ordered_output && next_range < ranges && finished[next_range]) {
+      replay(next_range);
+      next_range++;
+    }
+  };
 
-      // Collect all right rows with same join value
-      right_matches.push_back(right_row);
-      while (right_iter.has_next()) {
-        Row next_right = right_iter.next();
-        if (compare_values(next_right[right_col_idx], join_value) == 0) {
-          right_matches.push_back(next_right);
-        } else {
-          right_row = next_right;
-          break;
+  std::vector<size_t> range_rows(ranges, 0);
+  std::vector<MergeStats> range_stats(ranges);
+  std::vector<std::exception_ptr> errors(ranges);
+  std::vector<std::thread> workers;
+
+  for (size_t p = 0; p < ranges; ++p) {
+    workers.emplace_back([&, p] {
+      try {
+        // Range p covers keys in [splitters[p - 1], splitters[p])
+        const Value *lower = p > 0 ? &splitters[p - 1] : nullptr;
+        const Value *upper = p < splitters.size() ? &splitters[p] : nullptr;
+        std::pair<int, size_t> left_start(0, 0), right_start(0, 0);
+        if (lower) {
+          left_start = seek_sorted(sorted_left, left_col_idx, *lower);
+          right_start = seek_sorted(sorted_right, right_col_idx, *lower);
         }
-      }
-      if (!right_iter.has_next() &&
-          compare_values(right_matches.back()[right_col_idx], join_value) ==
-              0) {
-        right_valid = false;
-      }
 
-      // Create cartesian product of matches
-      for (const Row &l_row : left_matches) {
-        for (const Row &r_row : right_matches) {
-          result.result_rows.push_back(merge_rows(l_row, r_row));
+        RangeCursor left(sorted_left, left_col_idx, left_start, upper);
+        RangeCursor right(sorted_right, right_col_idx, right_start, upper);
+        SkewSpill skew(buffer_manager, group_bytes,
+                       sorted_left.get_name() + "_skew_" + std::to_string(p));
+        RowArena batch;
+        range_rows[p] =
+            merge_join_range(left, right, skew, [&](RowRef l, RowRef r) {
+              batch.append(l, r);
+              if (batch.size() >= OUTPUT_BATCH_ROWS) {
+                deliver(p, batch);
+              }
+            });
+        if (!batch.empty()) {
+          deliver(p, batch);
         }
+        range_stats[p] = skew.stats;
+      } catch (...) {
+        errors[p] = std::current_exception();
       }
+      finish(p);
+    });
+  }
 
-    } else if (cmp < 0) {
-      // Left value is smaller, advance left
-      if (left_iter.has_next()) {
-        left_row = left_iter.next();
-      } else {
-        left_valid = false;
-      }
-    } else {
-      // Right value is smaller, advance right
-      if (right_iter.has_next()) {
-        right_row = right_iter.next();
-      } else {
-        right_valid = false;
-      }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  // Left over only when a range failed
+  for (auto &spill : parked) {
+    if (spill) {
+      spill->finish()->drop();
+    }
+  }
+  for (const std::exception_ptr &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
     }
   }
 
-  result.total_io_operations = DiskManager::get_in_io_count() - initial_in_io +
-                               DiskManager::get_out_io_count() - initial_out_io;
-
-  std::cout << "Join completed. Result has " << result.result_rows.size()
-            << " rows with " << result.total_io_operations << " I/O operations."
-            << "In I/O: " << DiskManager::get_in_io_count()
-            << ", Out I/O: " << DiskManager::get_out_io_count() << "."
-            << std::endl;
-
-  return result;
+  size_t total_rows = 0;
+  stats = MergeStats();
+  for (size_t p = 0; p < ranges; ++p) {
+    total_rows += range_rows[p];
+    stats.spilled_groups += range_stats[p].spilled_groups;
+    stats.left_matched += range_stats[p].left_matched;
+    stats.right_matched += range_stats[p].right_matched;
+    stats.skipped_pages += range_stats[p].skipped_pages;
+  }
+  return total_rows;
 }
 
 std::shared_ptr<Table>
 external_sort(std::shared_ptr<Table> table, const std::string &sort_column,
-              std::shared_ptr<BufferManager> buffer_manager) {
+              std::shared_ptr<BufferManager> buffer_manager,
+              const JoinOptions &options, const ScanSpec &scan) {
 
   int sort_column_index = table->get_column_index(sort_column);
   if (sort_column_index == -1) {
     throw std::runtime_error("Sort column not found: " + sort_column);
   }
+  // One copy per sort column, so sorts of a table on different keys can be
+  // kept side by side. Projected copies are numbered, since each holds what
+  // one join asked for.
+  const std::string sorted_name =
+      scan.empty() ? table->get_name() + "_sorted_" + sort_column
+                   : table->get_name() + "_projected_" + sort_column + "_" +
+                         std::to_string(projected_copies.fetch_add(1));
+  const Schema sorted_schema =
+      ScanProjection(table->get_schema(), scan, sort_column).get_schema();
+  // Statistics describe the whole table, not a projected copy
+  auto sorted_stats = scan.empty() ? table->share_stats() : nullptr;
 
   // Phase 1: Create sorted runs
-  std::vector<std::string> run_files =
-      create_sorted_runs(table, sort_column_index, buffer_manager);
+  std::vector<std::string> run_files = create_sorted_runs(
+      table, sort_column_index, buffer_manager, options, scan);
 
   if (run_files.empty()) {
-    return table; // Empty table
+    if (scan.empty()) {
+      return table; // Empty table
+    }
+    // No row passed the scan
+    auto sorted_table =
+        std::make_shared<Table>(sorted_name, sorted_schema, buffer_manager);
+    sorted_table->truncate();
+    sorted_table->track_zones(sort_column);
+    sorted_table->set_sort_column(sort_column);
+    return sorted_table;
   }
 
   if (run_files.size() == 1) {
     // Only one run, create table from it
     auto sorted_table =
-        std::make_shared<Table>(table->get_name() + "_sorted",
-                                table->get_column_names(), buffer_manager);
+        std::make_shared<Table>(sorted_name, sorted_schema, buffer_manager);
+    sorted_table->truncate();
+    sorted_table->track_zones(sort_column);
 
     // Load data from run file
-    std::ifstream file(run_files[0]);
-    std::string line;
+    std::ifstream file(run_files[0], std::ios::binary);
+    RunRecord record;
     int page_id = 0;
-    auto current_page = std::make_shared<Page>(page_id);
-
-    while (std::getline(file, line)) {
-      if (line.empty())
-        continue;
-
-      std::vector<std::string> tokens;
-      std::stringstream ss(line);
-      std::string token;
+    auto current_page = sorted_table->new_page(page_id);
 
-      while (std::getline(ss, token, '|')) {
-        tokens.push_back(token);
+    while (read_run_record(file, record)) {
+      RowRef row{record.row.data(), record.row.size()};
+      if (!current_page->can_fit(row)) {
+        sorted_table->write_page(current_page);
+        page_id++;
+        current_page = sorted_table->new_page(page_id);
       }
 
-      if (!tokens.empty()) {
-        Row row(tokens);
-
-        if (current_page->is_full()) {
-          sorted_table->write_page(current_page);
-          page_id++;
-          current_page = std::make_shared<Page>(page_id);
-        }
-
-        current_page->add_row(row);
-      }
+      current_page->add_row(row);
     }
 
     if (!current_page->rows.empty()) {
@@ -199,6 +1028,8 @@ external_sort(std::shared_ptr<Table> table, const std::string &sort_column,
     }
 
     sorted_table->set_total_pages(page_id);
+    sorted_table->set_sort_column(sort_column);
+    sorted_table->set_stats(sorted_stats);
     file.close();
 
     // Clean up temporary file
@@ -209,42 +1040,29 @@ external_sort(std::shared_ptr<Table> table, const std::string &sort_column,
 
   // Phase 2: Merge runs
   std::string output_file = generate_temp_filename("final_sorted");
-  merge_sorted_runs(run_files, output_file, table->get_name() + "_sorted",
-                    sort_column_index, buffer_manager);
+  merge_sorted_runs(run_files, output_file, buffer_manager);
 
   // Create table from merged result
-  auto sorted_table = std::make_shared<Table>(
-      table->get_name() + "_sorted", table->get_column_names(), buffer_manager);
+  auto sorted_table =
+      std::make_shared<Table>(sorted_name, sorted_schema, buffer_manager);
+  sorted_table->truncate();
+  sorted_table->track_zones(sort_column);
 
   // Load data from output file
-  std::ifstream file(output_file);
-  std::string line;
+  std::ifstream file(output_file, std::ios::binary);
+  RunRecord record;
   int page_id = 0;
-  auto current_page = std::make_shared<Page>(page_id);
-
-  while (std::getline(file, line)) {
-    if (line.empty())
-      continue;
-
-    std::vector<std::string> tokens;
-    std::stringstream ss(line);
-    std::string token;
+  auto current_page = sorted_table->new_page(page_id);
 
-    while (std::getline(ss, token, '|')) {
-      tokens.push_back(token);
+  while (read_run_record(file, record)) {
+    RowRef row{record.row.data(), record.row.size()};
+    if (!current_page->can_fit(row)) {
+      sorted_table->write_page(current_page);
+      page_id++;
+      current_page = sorted_table->new_page(page_id);
     }
 
-    if (!tokens.empty()) {
-      Row row(tokens);
-
-      if (current_page->is_full()) {
-        sorted_table->write_page(current_page);
-        page_id++;
-        current_page = std::make_shared<Page>(page_id);
-      }
-
-      current_page->add_row(row);
-    }
+    current_page->add_row(row);
   }
 
   if (!current_page->rows.empty()) {
@@ -253,6 +1071,8 @@ external_sort(std::shared_ptr<Table> table, const std::string &sort_column,
   }
 
   sorted_table->set_total_pages(page_id);
+  sorted_table->set_sort_column(sort_column);
+  sorted_table->set_stats(sorted_stats);
   file.close();
 
   // Clean up temporary files
@@ -266,141 +1086,215 @@ external_sort(std::shared_ptr<Table> table, const std::string &sort_column,
 
 std::vector<std::string>
 create_sorted_runs(std::shared_ptr<Table> table, int sort_column_index,
-                   std::shared_ptr<BufferManager> buffer_manager) {
-
-  std::vector<std::string> run_files;
-  std::vector<Row> buffer;
-  int run_number = 0;
+                   std::shared_ptr<BufferManager> buffer_manager,
+                   const JoinOptions &options, const ScanSpec &scan) {
+
+  // Rows are filtered and projected as they are read, so the runs only
+  // carry what the scan keeps
+  const std::string &sort_column = table->get_schema()[sort_column_index].name;
+  ScanProjection projection(table->get_schema(), scan, sort_column);
+  const Schema &schema = projection.get_schema();
+  const int run_key_index = schema.get_column_index(sort_column);
+  size_t rows_read = 0;
+  size_t rows_kept = 0;
+  auto report_scan = [&] {
+    if (!scan.empty()) {
+      std::cout << table->get_name() << " scan kept " << rows_kept << " of "
+                << rows_read << " rows and " << schema.size() << " of "
+                << table->get_schema().size() << " columns" << std::endl;
+    }
+  };
 
-  // Use 3 pages for sorting (reserve 1 page for buffer management)
-  const int SORT_BUFFER_PAGES = 3;
-  const int SORT_BUFFER_SIZE = SORT_BUFFER_PAGES * Page::MAX_ROWS;
+  // The sort memory grant comes from the buffer manager, measured in bytes.
+  // Each worker sorts its own slice of it, which must stay big enough to be
+  // worth a thread.
+  const size_t sort_buffer_bytes = buffer_manager->get_sort_buffer_bytes();
+  const size_t min_slice_bytes = 2 * buffer_manager->get_page_size();
+  const size_t threads = std::max<size_t>(
+      1, std::min(options.sort_threads, sort_buffer_bytes / min_slice_bytes));
+
+  auto table_iter = table->get_iterator(AccessHint::Sequential);
+  // A predicate on a column with zones lets the scan pass over pages that
+  // cannot hold a matching row
+  for (const Predicate &predicate : scan.predicates) {
+    int column = table->get_column_index(predicate.column);
+    if (!table->has_zones(column) || predicate.op == CompareOp::NotEqual) {
+      continue;
+    }
+    bool bounded_below = predicate.op == CompareOp::Equal ||
+                         predicate.op == CompareOp::Greater ||
+                         predicate.op == CompareOp::GreaterEqual;
+    bool bounded_above = predicate.op == CompareOp::Equal ||
+                         predicate.op == CompareOp::Less ||
+                         predicate.op == CompareOp::LessEqual;
+    table_iter.set_key_range(column,
+                             bounded_below ? &predicate.value : nullptr,
+                             bounded_above ? &predicate.value : nullptr);
+    break;
+  }
 
-  auto table_iter = table->get_iterator();
+  if (threads == 1) {
+    RunGenerator generator(schema, run_key_index, sort_buffer_bytes, "run");
+    RowRef row;
+    while (table_iter.has_next()) {
+      rows_read++;
+      if (projection.apply(table_iter.next_ref(), row)) {
+        rows_kept++;
+        generator.add(row);
+      }
+    }
+    report_scan();
+    return generator.finish();
+  }
 
-  while (table_iter.has_next()) {
-    // Fill buffer
-    buffer.clear();
+  // This thread keeps scanning the table and deals page-sized batches of
+  // rows to the workers in turn; each worker encodes, sorts and writes its
+  // own runs concurrently
+  const size_t slice_bytes = sort_buffer_bytes / threads;
+  std::vector<std::unique_ptr<BatchQueue>> queues;
+  std::vector<std::vector<std::string>> worker_runs(threads);
+  std::vector<std::exception_ptr> worker_errors(threads);
+  std::vector<std::thread> workers;
+
+  for (size_t w = 0; w < threads; ++w) {
+    queues.push_back(std::make_unique<BatchQueue>(2));
+  }
+  for (size_t w = 0; w < threads; ++w) {
+    workers.emplace_back([&, w] {
+      RunGenerator generator(schema, run_key_index, slice_bytes,
+                             "run_w" + std::to_string(w));
+      RowArena batch;
+      while (queues[w]->pop(batch)) {
+        if (worker_errors[w]) {
+          continue; // Keep draining so the scanner never blocks
+        }
+        try {
+          for (size_t i = 0; i < batch.size(); ++i) {
+            generator.add(batch[i]);
+          }
+        } catch (...) {
+          worker_errors[w] = std::current_exception();
+        }
+      }
+      try {
+        worker_runs[w] = generator.finish();
+      } catch (...) {
+        worker_errors[w] = std::current_exception();
+      }
+    });
+  }
 
-    for (int i = 0; i < SORT_BUFFER_SIZE && table_iter.has_next(); ++i) {
-      buffer.push_back(table_iter.next());
+  std::exception_ptr scan_error;
+  try {
+    const size_t batch_bytes = buffer_manager->get_page_size();
+    RowArena batch;
+    RowRef row;
+    size_t next_worker = 0;
+
+    while (table_iter.has_next()) {
+      rows_read++;
+      if (!projection.apply(table_iter.next_ref(), row)) {
+        continue;
+      }
+      rows_kept++;
+      batch.append(row);
+      if (batch.byte_size() >= batch_bytes) {
+        queues[next_worker]->push(std::move(batch));
+        next_worker = (next_worker + 1) % threads;
+        batch = RowArena();
+      }
     }
+    if (!batch.empty()) {
+      queues[next_worker]->push(std::move(batch));
+    }
+  } catch (...) {
+    scan_error = std::current_exception();
+  }
 
-    if (buffer.empty())
-      break;
-
-    // Sort buffer
-    std::sort(buffer.begin(), buffer.end(),
-              [sort_column_index](const Row &a, const Row &b) {
-                return compare_values(a[sort_column_index],
-                                      b[sort_column_index]) < 0;
-              });
+  for (auto &queue : queues) {
+    queue->close();
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
 
-    // Write sorted run to file
-    std::string run_filename =
-        generate_temp_filename("run_" + std::to_string(run_number));
-    std::ofstream run_file(run_filename);
+  std::vector<std::string> run_files;
+  for (const auto &runs : worker_runs) {
+    run_files.insert(run_files.end(), runs.begin(), runs.end());
+  }
 
-    for (const Row &row : buffer) {
-      for (size_t j = 0; j < row.size(); ++j) {
-        if (j > 0)
-          run_file << "|";
-        run_file << row[j];
-      }
-      run_file << std::endl;
+  std::exception_ptr error = scan_error;
+  for (const std::exception_ptr &worker_error : worker_errors) {
+    if (!error) {
+      error = worker_error;
     }
-
-    run_file.close();
-    run_files.push_back(run_filename);
-    run_number++;
+  }
+  if (error) {
+    for (const std::string &run_file : run_files) {
+      std::remove(run_file.c_str());
+    }
+    std::rethrow_exception(error);
   }
 
+  report_scan();
   return run_files;
 }
 
 void merge_sorted_runs(const std::vector<std::string> &run_files,
                        const std::string &output_file,
-                       const std::string &table_name, int sort_column_index,
                        std::shared_ptr<BufferManager> buffer_manager) {
 
-  // Priority queue for k-way merge
-  struct RunEntry {
-    Row row;
-    int run_id;
-  };
-
-  // Lambda comparator for priority queue
-  auto cmp = [sort_column_index](const RunEntry &a, const RunEntry &b) {
-    return compare_values(a.row[sort_column_index], b.row[sort_column_index]) >
-           0;
-  };
-
-  std::priority_queue<RunEntry, std::vector<RunEntry>, decltype(cmp)> pq(cmp);
-  std::vector<std::ifstream> run_streams(run_files.size());
-
-  // Open all run files and initialize priority queue
-  for (size_t i = 0; i < run_files.size(); ++i) {
-    run_streams[i].open(run_files[i]);
+  // Each input run streams through one page of the sort grant and the
+  // output takes another, which bounds how many runs one pass may merge
+  const size_t fan_in =
+      std::max<size_t>(2, buffer_manager->get_sort_buffer_pages() - 1);
 
-    std::string line;
-    if (std::getline(run_streams[i], line) && !line.empty()) {
-      std::vector<std::string> tokens;
-      std::stringstream ss(line);
-      std::string token;
-
-      while (std::getline(ss, token, '|')) {
-        tokens.push_back(token);
-      }
-
-      if (!tokens.empty()) {
-        RunEntry entry;
-        entry.row = Row(tokens);
-        entry.run_id = i;
-        pq.push(entry);
-      }
-    }
+  // Runs are merged smallest first so large runs are rewritten fewer times
+  using SizedRun = std::pair<uintmax_t, std::string>;
+  std::priority_queue<SizedRun, std::vector<SizedRun>, std::greater<SizedRun>>
+      runs;
+  for (const std::string &run_file : run_files) {
+    runs.emplace(std::filesystem::file_size(run_file), run_file);
   }
+  std::unordered_set<std::string> intermediate_files;
 
-  // Merge runs
-  std::ofstream output(output_file);
-
-  while (!pq.empty()) {
-    RunEntry min_entry = pq.top();
-    pq.pop();
-
-    // Write to output
-    for (size_t j = 0; j < min_entry.row.size(); ++j) {
-      if (j > 0)
-        output << "|";
-      output << min_entry.row[j];
+  auto take_smallest = [&runs](size_t count) {
+    std::vector<std::string> inputs;
+    while (inputs.size() < count && !runs.empty()) {
+      inputs.push_back(runs.top().second);
+      runs.pop();
     }
-    output << std::endl;
-
-    // Read next row from the same run
-    std::string line;
-    if (std::getline(run_streams[min_entry.run_id], line) && !line.empty()) {
-      std::vector<std::string> tokens;
-      std::stringstream ss(line);
-      std::string token;
-
-      while (std::getline(ss, token, '|')) {
-        tokens.push_back(token);
-      }
-
-      if (!tokens.empty()) {
-        RunEntry entry;
-        entry.row = Row(tokens);
-        entry.run_id = min_entry.run_id;
-        pq.push(entry);
+    return inputs;
+  };
+  auto remove_intermediates = [&](const std::vector<std::string> &inputs) {
+    for (const std::string &input : inputs) {
+      if (intermediate_files.erase(input) > 0) {
+        std::remove(input.c_str());
       }
     }
-  }
+  };
 
-  // Close all files
-  output.close();
-  for (auto &stream : run_streams) {
-    stream.close();
+  // The first pass merges just enough runs that every later pass, including
+  // the final one, is a full fan_in-way merge
+  size_t merge_count = runs.size() <= fan_in
+                           ? runs.size()
+                           : (runs.size() - 2) % (fan_in - 1) + 2;
+
+  while (runs.size() > fan_in) {
+    std::vector<std::string> inputs = take_smallest(merge_count);
+    std::string merged_file = generate_temp_filename("merge");
+    merge_run_files(inputs, merged_file);
+    remove_intermediates(inputs);
+
+    intermediate_files.insert(merged_file);
+    runs.emplace(std::filesystem::file_size(merged_file), merged_file);
+    merge_count = fan_in;
   }
+
+  // Final pass
+  std::vector<std::string> inputs = take_smallest(runs.size());
+  merge_run_files(inputs, output_file);
+  remove_intermediates(inputs);
 }
 
 Row merge_rows(const Row &left_row, const Row &right_row) {
@@ -418,33 +1312,72 @@ Row merge_rows(const Row &left_row, const Row &right_row) {
   return result;
 }
 
-int compare_values(const std::string &a, const std::string &b) {
-  // Try numeric comparison first
-  try {
-    double num_a = std::stod(a);
-    double num_b = std::stod(b);
+Schema join_result_schema(const Table &left_table, const Table &right_table) {
+  return join_result_schema(left_table.get_schema(), right_table.get_schema());
+}
+
+Schema join_result_schema(const Schema &left_schema,
+                          const Schema &right_schema) {
+  std::vector<Column> result_columns;
+  for (const Column &col : left_schema.get_columns()) {
+    result_columns.emplace_back("left_" + col.name, col.type, col.length);
+  }
+  for (const Column &col : right_schema.get_columns()) {
+    result_columns.emplace_back("right_" + col.name, col.type, col.length);
+  }
+  return Schema(result_columns);
+}
+
+int compare_values(const Value &a, const Value &b) {
+  if (a.index() == b.index()) {
+    return std::visit(
+        [&b](const auto &lhs) {
+          using T = std::decay_t<decltype(lhs)>;
+          const T &rhs = std::get<T>(b);
+          if constexpr (std::is_same_v<T, Date>) {
+            return lhs.days < rhs.days ? -1 : (lhs.days > rhs.days ? 1 : 0);
+          } else {
+            return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+          }
+        },
+        a);
+  }
 
+  // Join columns of different numeric types compare by value
+  auto as_double = [](const Value &v, double &out) {
+    if (const int64_t *i = std::get_if<int64_t>(&v)) {
+      out = static_cast<double>(*i);
+      return true;
+    }
+    if (const double *d = std::get_if<double>(&v)) {
+      out = *d;
+      return true;
+    }
+    return false;
+  };
+  double num_a, num_b;
+  if (as_double(a, num_a) && as_double(b, num_b)) {
     if (num_a < num_b)
       return -1;
     if (num_a > num_b)
       return 1;
     return 0;
-  } catch (...) {
-    // Fall back to string comparison
-    if (a < b)
-      return -1;
-    if (a > b)
-      return 1;
-    return 0;
   }
+
+  return a.index() < b.index() ? -1 : 1;
 }
 
 std::string generate_temp_filename(const std::string &prefix) {
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
-  static std::uniform_int_distribution<> dis(1000, 9999);
-
-  return "temp_" + prefix + "_" + std::to_string(dis(gen)) + ".tmp";
+  // The random tag separates concurrent processes; the sequence number keeps
+  // names unique within one, since a multi-pass merge creates many files
+  static const int tag = [] {
+    std::random_device rd;
+    return std::uniform_int_distribution<>(1000, 9999)(rd);
+  }();
+  static std::atomic<unsigned> sequence(0);
+
+  return "temp_" + prefix + "_" + std::to_string(tag) + "_" +
+         std::to_string(sequence.fetch_add(1)) + ".tmp";
 }
 
 void write_join_result_to_file(const JoinResult &result,
@@ -455,16 +1388,17 @@ void write_join_result_to_file(const JoinResult &result,
   std::string output_table_name =
       left_table_name + "_" + right_table_name + "_join";
   auto output_table = std::make_shared<Table>(
-      output_table_name, result.result_columns, buffer_manager);
+      output_table_name, result.result_schema, buffer_manager);
+  output_table->truncate();
 
   int page_id = 0;
-  auto current_page = std::make_shared<Page>(page_id);
+  auto current_page = output_table->new_page(page_id);
 
   for (const Row &row : result.result_rows) {
-    if (current_page->is_full()) {
+    if (!current_page->can_fit(row)) {
       output_table->write_page(current_page);
       page_id++;
-      current_page = std::make_shared<Page>(page_id);
+      current_page = output_table->new_page(page_id);
     }
     current_page->add_row(row);
   }
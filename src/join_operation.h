@@ -1,48 +1,163 @@
 #ifndef JOIN_OPERATIONS_H
 #define JOIN_OPERATIONS_H
 
+#include "scan_projection.h"
+#include "schema.h"
 #include <memory>
 #include <string>
 #include <vector>
 
 class Table;
 class BufferManager;
-class Row;
 
 namespace JoinOperations {
 
+class BPlusTree;
+class JoinSink;
+class SortedTableCache;
+
+// Auto lets the planner pick the algorithm with the lower estimated I/O
+enum class JoinAlgorithm { Auto, SortMerge, Hash, IndexNestedLoop };
+
 struct JoinResult {
-  std::vector<Row> result_rows;
-  std::vector<std::string> result_columns;
+  std::vector<Row> result_rows; // Only filled when no sink is given
+  Schema result_schema;
+  size_t row_count;
   int total_io_operations;
+  // Set by the planner: the algorithm that ran and the I/O it expected
+  JoinAlgorithm algorithm;
+  int estimated_io_operations;
+  // Duplicate key groups too large for memory that a sort-merge join
+  // spilled and joined by block nested loop
+  size_t spilled_groups;
+  // With JoinOptions::bloom_filter: rows of the filtered input dropped
+  // before the sort, and the share of its rows without a partner that the
+  // filter let through
+  size_t bloom_rows_eliminated;
+  double bloom_false_positive_rate;
+
+  JoinResult()
+      : row_count(0), total_io_operations(0),
+        algorithm(JoinAlgorithm::SortMerge), estimated_io_operations(0),
+        spilled_groups(0), bloom_rows_eliminated(0),
+        bloom_false_positive_rate(0) {}
+};
 
-  JoinResult() : total_io_operations(0) {}
+// Counts kept by the merge phase of a sort-merge join
+struct MergeStats {
+  // Duplicate key groups spilled and joined by block nested loop
+  size_t spilled_groups = 0;
+  // Rows of each input that met at least one row of the other
+  size_t left_matched = 0;
+  size_t right_matched = 0;
+  // Pages the cursors skipped without reading, using zone maps
+  size_t skipped_pages = 0;
+};
+
+struct JoinOptions {
+  // Threads generating sorted runs. Each sorts its own slice of the sort
+  // grant, so fewer are used when a slice would drop below two pages.
+  size_t sort_threads = 1;
+  // Ranges of the key domain merged in parallel after sorting. Each range
+  // pins a page of both inputs, and one more while joining a spilled key
+  // group, so at most (pool pages - 1) / 3 are used.
+  size_t join_threads = 1;
+  // With several join threads, true emits the ranges in key order so the
+  // result matches the serial join exactly; false emits rows as each range
+  // produces them. Rows of a spilled key group come in blocks sized by each
+  // range's memory, so only their order within the group may differ.
+  bool ordered_output = true;
+  // Algorithm used by execute_join
+  JoinAlgorithm algorithm = JoinAlgorithm::Auto;
+  // When set, sort-merge joins reuse sorted copies kept here and add the
+  // ones they make
+  SortedTableCache *sorted_cache = nullptr;
+  // Columns and predicates a sort-merge join applies to each input while
+  // creating its sorted runs, so the runs, the sorted copy and the output
+  // only carry the rows and columns asked for. An input with a scan is
+  // always sorted into a temporary copy, bypassing sorted_cache, and the
+  // planner picks sort-merge for it since hash_join reads whole rows.
+  ScanSpec left_scan;
+  ScanSpec right_scan;
+  // Semi-join reduction for sort-merge joins: a Bloom filter is built on the
+  // join keys of the input with fewer pages and rows of the other input it
+  // rules out are dropped while that input's runs are generated, as by a
+  // scan, so that input skips sorted_cache. Skipped when the other input
+  // needs no sort.
+  bool bloom_filter = false;
+  // B+-tree indexes execute_join may probe with an index nested-loop join
+  // when one covers an input on its join column and is still current
+  std::vector<std::shared_ptr<const BPlusTree>> indexes;
 };
 
 JoinResult sort_merge_join(std::shared_ptr<Table> left_table,
                            std::shared_ptr<Table> right_table,
                            const std::string &left_column,
                            const std::string &right_column,
-                           std::shared_ptr<BufferManager> buffer_manager);
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           const JoinOptions &options = JoinOptions());
+
+// Streams output rows to `sink` in batches as matches are found instead of
+// collecting them in result_rows
+JoinResult sort_merge_join(std::shared_ptr<Table> left_table,
+                           std::shared_ptr<Table> right_table,
+                           const std::string &left_column,
+                           const std::string &right_column,
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           JoinSink &sink,
+                           const JoinOptions &options = JoinOptions());
 
 // Helper functions for sort-merge join
+
+// Merge phase over two sorted tables split into disjoint key ranges, one
+// thread per range. Each range holds the two sides of a key group in
+// group_bytes each and spills larger groups through the buffer pool. With
+// ordered_output, rows of a range whose turn has not come are parked in a
+// spill table too, so memory does not grow with the output.
+// Returns the number of rows sent to the sink; stats is set to the counts of
+// all ranges.
+size_t parallel_merge_join(Table &sorted_left, int left_col_idx,
+                           Table &sorted_right, int right_col_idx,
+                           size_t partitions, bool ordered_output,
+                           JoinSink &sink,
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           size_t group_bytes, MergeStats &stats);
+
+// The sorted copy keeps zone maps on the sort column. With a non-empty scan
+// it holds only the rows and columns the scan selects and gets a unique
+// name; the caller drops it when done.
 std::shared_ptr<Table>
 external_sort(std::shared_ptr<Table> table, const std::string &sort_column,
-              std::shared_ptr<BufferManager> buffer_manager);
+              std::shared_ptr<BufferManager> buffer_manager,
+              const JoinOptions &options = JoinOptions(),
+              const ScanSpec &scan = ScanSpec());
 
+// Merges at most (sort grant pages - 1) runs per pass, smallest runs first,
+// until a single sorted output_file remains
 void merge_sorted_runs(const std::vector<std::string> &run_files,
                        const std::string &output_file,
-                       const std::string &table_name, int sort_column_index,
                        std::shared_ptr<BufferManager> buffer_manager);
 
+// Run rows are projected by scan while the table is read. Pages whose zones
+// rule out one of its predicates are not read.
 std::vector<std::string>
 create_sorted_runs(std::shared_ptr<Table> table, int sort_column_index,
-                   std::shared_ptr<BufferManager> buffer_manager);
+                   std::shared_ptr<BufferManager> buffer_manager,
+                   const JoinOptions &options = JoinOptions(),
+                   const ScanSpec &scan = ScanSpec());
 
 Row merge_rows(const Row &left_row, const Row &right_row);
+// Columns of the left table prefixed "left_", then the right table's
+// prefixed "right_". sort_merge_join passes its sorted inputs, so a
+// projected input contributes only its kept columns.
+Schema join_result_schema(const Table &left_table, const Table &right_table);
+Schema join_result_schema(const Schema &left_schema,
+                          const Schema &right_schema);
 
 // Utility functions
-int compare_values(const std::string &a, const std::string &b);
+// Orders values of the same type natively; int64 and double compare
+// numerically, and any other mix orders by type
+int compare_values(const Value &a, const Value &b);
 std::string generate_temp_filename(const std::string &prefix);
 
 void write_join_result_to_file(const JoinResult &result,
@@ -0,0 +1,281 @@
+#include "join_planner.h"
+#include "buffer_manager.h"
+#include "bplus_tree.h"
+#include "hash_join.h"
+#include "index_join.h"
+#include "sorted_table_cache.h"
+#include "table.h"
+#include "table_stats.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace JoinOperations {
+
+namespace {
+
+// Output pages from the table statistics, assuming join keys spread evenly:
+// |L| * |R| / max(distinct keys) rows, each as wide as an average left row
+// and right row together. Without statistics, assumes a foreign-key join
+// where each row of the larger input meets one row of similar width.
+double estimate_output_pages(const Table &left_table, int left_col_idx,
+                             const Table &right_table, int right_col_idx,
+                             size_t page_size) {
+  const TableStats *left_stats = left_table.get_stats();
+  const TableStats *right_stats = right_table.get_stats();
+  if (!left_stats || !right_stats || left_stats->row_count == 0 ||
+      right_stats->row_count == 0 || left_col_idx < 0 || right_col_idx < 0) {
+    return 2.0 * std::max(left_table.get_total_pages(),
+                          right_table.get_total_pages());
+  }
+
+  const double left_rows = left_stats->row_count;
+  const double right_rows = right_stats->row_count;
+  const double distinct = std::max<double>(
+      1, std::max(left_stats->columns[left_col_idx].distinct_count,
+                  right_stats->columns[right_col_idx].distinct_count));
+  const double output_rows = left_rows * right_rows / distinct;
+  const double row_bytes = left_stats->row_bytes / left_rows +
+                           right_stats->row_bytes / right_rows;
+  return output_rows * row_bytes / page_size;
+}
+
+// Position of a value on the number line, for numbers and dates
+bool numeric_value(const Value &value, double &out) {
+  if (const int64_t *integer = std::get_if<int64_t>(&value)) {
+    out = static_cast<double>(*integer);
+  } else if (const double *real = std::get_if<double>(&value)) {
+    out = *real;
+  } else if (const Date *date = std::get_if<Date>(&value)) {
+    out = date->days;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Share of the table's rows passing every predicate of the scan, taking
+// columns as independent and their values as spread evenly: 1/distinct for
+// an equality, the covered part of [min, max] for a range over numbers or
+// dates, and a third for any other range. Without statistics, 1.
+double estimate_selectivity(const Table &table, const ScanSpec &scan) {
+  const TableStats *stats = table.get_stats();
+  if (!stats) {
+    return 1.0;
+  }
+  double selectivity = 1.0;
+  for (const Predicate &predicate : scan.predicates) {
+    int index = table.get_column_index(predicate.column);
+    if (index < 0 || static_cast<size_t>(index) >= stats->columns.size()) {
+      continue;
+    }
+    const ColumnStats &column = stats->columns[index];
+    const double distinct =
+        std::max<double>(1, static_cast<double>(column.distinct_count));
+    double value, low, high;
+    double share = 1.0 / 3;
+    if (predicate.op == CompareOp::Equal) {
+      share = 1 / distinct;
+    } else if (predicate.op == CompareOp::NotEqual) {
+      share = 1 - 1 / distinct;
+    } else if (column.has_range && numeric_value(predicate.value, value) &&
+               numeric_value(column.min_value, low) &&
+               numeric_value(column.max_value, high)) {
+      // Share of the rows below the value
+      double below = high > low ? std::clamp((value - low) / (high - low),
+                                             0.0, 1.0)
+                                : (value > low ? 1.0 : 0.0);
+      share = predicate.op == CompareOp::Less ||
+                      predicate.op == CompareOp::LessEqual
+                  ? below
+                  : 1 - below;
+    }
+    selectivity *= share;
+  }
+  return selectivity;
+}
+
+} // namespace
+
+const char *join_algorithm_name(JoinAlgorithm algorithm) {
+  switch (algorithm) {
+  case JoinAlgorithm::Auto:
+    return "auto";
+  case JoinAlgorithm::SortMerge:
+    return "sort-merge";
+  case JoinAlgorithm::Hash:
+    return "hash";
+  case JoinAlgorithm::IndexNestedLoop:
+    return "index-nested-loop";
+  }
+  return "unknown";
+}
+
+JoinAlgorithm parse_join_algorithm(const std::string &name) {
+  if (name == "auto") {
+    return JoinAlgorithm::Auto;
+  }
+  if (name == "sort-merge") {
+    return JoinAlgorithm::SortMerge;
+  }
+  if (name == "hash") {
+    return JoinAlgorithm::Hash;
+  }
+  if (name == "index-nested-loop") {
+    return JoinAlgorithm::IndexNestedLoop;
+  }
+  throw std::runtime_error("Unknown join algorithm: " + name);
+}
+
+JoinPlan plan_join(const Table &left_table, const std::string &left_column,
+                   const Table &right_table, const std::string &right_column,
+                   const BufferManager &buffer_manager,
+                   const JoinOptions &options) {
+  const double left_pages = left_table.get_total_pages();
+  const double right_pages = right_table.get_total_pages();
+  const double left_selectivity =
+      estimate_selectivity(left_table, options.left_scan);
+  const double right_selectivity =
+      estimate_selectivity(right_table, options.right_scan);
+  const double output_pages =
+      estimate_output_pages(left_table,
+                            left_table.get_column_index(left_column),
+                            right_table,
+                            right_table.get_column_index(right_column),
+                            buffer_manager.get_page_size()) *
+      left_selectivity * right_selectivity;
+
+  // An input already in join key order, or with a cached sorted copy, is
+  // only read by the merge. An input with a scan is read once and its
+  // projected copy written and read back; the share of columns kept stands
+  // in for the share of bytes.
+  auto sort_merge_input_io = [&](const Table &table, const std::string &column,
+                                 const ScanSpec &scan) {
+    const double pages = table.get_total_pages();
+    if (!scan.empty()) {
+      const double kept =
+          static_cast<double>(
+              ScanProjection(table.get_schema(), scan, column)
+                  .get_schema()
+                  .size()) /
+          table.get_schema().size();
+      return pages * (1 + 2 * kept * estimate_selectivity(table, scan));
+    }
+    bool sorted = table.get_sort_column() == column ||
+                  (options.sorted_cache &&
+                   options.sorted_cache->contains(table, column));
+    return (sorted ? 1 : 3) * pages;
+  };
+
+  JoinPlan plan;
+  plan.sort_merge_io = static_cast<int>(
+      sort_merge_input_io(left_table, left_column, options.left_scan) +
+      sort_merge_input_io(right_table, right_column, options.right_scan) +
+      output_pages + 0.5);
+  plan.hash_io = static_cast<int>(
+      estimate_hash_join_io(std::min(left_pages, right_pages),
+                            std::max(left_pages, right_pages),
+                            buffer_manager.get_sort_buffer_pages()) +
+      output_pages + 0.5);
+
+  // The outer input's predicates cut the lookups; an inner row meets an
+  // outer key as often as the inner key repeats
+  plan.index_io = -1;
+  if (const BPlusTree *index = find_join_index(
+          left_table, left_column, right_table, right_column, options)) {
+    const bool inner_is_left = !index->covers(right_table, right_column);
+    const Table &outer = inner_is_left ? right_table : left_table;
+    const Table &inner = inner_is_left ? left_table : right_table;
+    const TableStats *outer_stats = outer.get_stats();
+    const TableStats *inner_stats = inner.get_stats();
+    const int inner_col_idx =
+        inner.get_column_index(inner_is_left ? left_column : right_column);
+
+    // Without statistics, outer pages hold as many rows as inner ones
+    const double outer_rows =
+        outer_stats ? outer_stats->row_count
+                    : outer.get_total_pages() *
+                          static_cast<double>(index->get_entry_count()) /
+                          std::max(1, inner.get_total_pages());
+    double matches = 1;
+    if (inner_stats && inner_col_idx >= 0 &&
+        inner_stats->columns[inner_col_idx].distinct_count > 0) {
+      matches = static_cast<double>(inner_stats->row_count) /
+                inner_stats->columns[inner_col_idx].distinct_count;
+    }
+    plan.index_io = static_cast<int>(
+        estimate_index_join_io(
+            outer.get_total_pages(),
+            outer_rows * (inner_is_left ? right_selectivity : left_selectivity),
+            matches, *index, inner.get_total_pages(),
+            buffer_manager.get_pool_size()) +
+        output_pages + 0.5);
+  }
+
+  // Only the sort-merge and index joins push scans into their inputs
+  const bool has_scan =
+      !options.left_scan.empty() || !options.right_scan.empty();
+  JoinAlgorithm requested = options.algorithm;
+  if (requested == JoinAlgorithm::IndexNestedLoop && plan.index_io < 0) {
+    requested = JoinAlgorithm::Auto;
+  }
+  if (requested == JoinAlgorithm::Hash && has_scan) {
+    requested = JoinAlgorithm::SortMerge;
+  }
+  if (requested != JoinAlgorithm::Auto) {
+    plan.algorithm = requested;
+    plan.requested = requested == options.algorithm;
+    return plan;
+  }
+  plan.algorithm = JoinAlgorithm::SortMerge;
+  int best_io = plan.sort_merge_io;
+  if (!has_scan && plan.hash_io < best_io) {
+    plan.algorithm = JoinAlgorithm::Hash;
+    best_io = plan.hash_io;
+  }
+  if (plan.index_io >= 0 && plan.index_io < best_io) {
+    plan.algorithm = JoinAlgorithm::IndexNestedLoop;
+  }
+  return plan;
+}
+
+JoinResult execute_join(std::shared_ptr<Table> left_table,
+                        std::shared_ptr<Table> right_table,
+                        const std::string &left_column,
+                        const std::string &right_column,
+                        std::shared_ptr<BufferManager> buffer_manager,
+                        JoinSink &sink, const JoinOptions &options) {
+  JoinPlan plan = plan_join(*left_table, left_column, *right_table,
+                            right_column, *buffer_manager, options);
+  std::cout << "Plan: " << join_algorithm_name(plan.algorithm) << " join"
+            << (plan.requested ? ", as requested" : "")
+            << " (estimated I/O: sort-merge " << plan.sort_merge_io
+            << ", hash " << plan.hash_io;
+  if (plan.index_io >= 0) {
+    std::cout << ", index nested-loop " << plan.index_io;
+  }
+  std::cout << ")" << std::endl;
+
+  JoinResult result;
+  switch (plan.algorithm) {
+  case JoinAlgorithm::Hash:
+    result = hash_join(left_table, right_table, left_column, right_column,
+                       buffer_manager, sink);
+    break;
+  case JoinAlgorithm::IndexNestedLoop:
+    result = index_nested_loop_join(
+        left_table, right_table, left_column, right_column,
+        *find_join_index(*left_table, left_column, *right_table,
+                         right_column, options),
+        buffer_manager, sink, options);
+    break;
+  default:
+    result = sort_merge_join(left_table, right_table, left_column,
+                             right_column, buffer_manager, sink, options);
+  }
+  result.algorithm = plan.algorithm;
+  result.estimated_io_operations = plan.estimated_io();
+  return result;
+}
+
+} // namespace JoinOperations
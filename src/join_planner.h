@@ -0,0 +1,67 @@
+#ifndef JOIN_PLANNER_H
+#define JOIN_PLANNER_H
+
+#include "join_operation.h"
+
+namespace JoinOperations {
+
+// Estimated page I/O of each join algorithm for a pair of inputs, and the
+// algorithm chosen
+struct JoinPlan {
+  JoinAlgorithm algorithm;
+  int sort_merge_io;
+  int hash_io;
+  int index_io; // -1 when no index in the options covers an input
+  bool requested = false; // options.algorithm, taken as is rather than by cost
+
+  int estimated_io() const {
+    switch (algorithm) {
+    case JoinAlgorithm::Hash:
+      return hash_io;
+    case JoinAlgorithm::IndexNestedLoop:
+      return index_io;
+    default:
+      return sort_merge_io;
+    }
+  }
+};
+
+const char *join_algorithm_name(JoinAlgorithm algorithm);
+// Accepts "auto", "hash", "sort-merge" and "index-nested-loop"
+JoinAlgorithm parse_join_algorithm(const std::string &name);
+
+// Costs both algorithms from the table page counts and the sort grant.
+// Both estimates include writing the output, sized from the tables'
+// statistics when they have them:
+//   sort-merge  each input is read, written sorted and read again: 3(L + R),
+//               or only read once if the table is already sorted on the join
+//               key or options.sorted_cache holds its copy; an input with
+//               a scan writes and reads only its kept columns
+//   hash        one pass over both inputs when the smaller one fits in the
+//               grant, plus a write and a read of each spilled partition
+//   index       with an index from options.indexes on one input's join
+//               column: one pass over the other input plus the index and
+//               inner pages its lookups read (estimate_index_join_io)
+// Predicates of a scan are credited with the share of rows they keep,
+// estimated from the column statistics. Auto picks the cheapest plan; ties
+// go to sort-merge, whose output is ordered by key. Inputs with a scan
+// never get hash, and an index join asked for without a covering index
+// falls back to the auto choice between the other two.
+JoinPlan plan_join(const Table &left_table, const std::string &left_column,
+                   const Table &right_table, const std::string &right_column,
+                   const BufferManager &buffer_manager,
+                   const JoinOptions &options = JoinOptions());
+
+// Plans the join, runs the chosen algorithm and records its estimate in the
+// result next to the measured I/O
+JoinResult execute_join(std::shared_ptr<Table> left_table,
+                        std::shared_ptr<Table> right_table,
+                        const std::string &left_column,
+                        const std::string &right_column,
+                        std::shared_ptr<BufferManager> buffer_manager,
+                        JoinSink &sink,
+                        const JoinOptions &options = JoinOptions());
+
+} // namespace JoinOperations
+
+#endif // JOIN_PLANNER_H
@@ -0,0 +1,51 @@
+#include "join_sink.h"
+#include "buffer_manager.h"
+#include "table.h"
+
+namespace JoinOperations {
+
+void CollectSink::open(const Schema &output_schema) { schema = output_schema; }
+
+void CollectSink::consume(const RowArena &batch) {
+  for (size_t i = 0; i < batch.size(); ++i) {
+    schema.deserialize_row(batch[i], rows.emplace_back());
+  }
+}
+
+TableSink::TableSink(const std::string &name,
+                     std::shared_ptr<BufferManager> bm)
+    : table_name(name), buffer_manager(bm), page_id(0) {}
+
+void TableSink::open(const Schema &schema) {
+  table = std::make_shared<Table>(table_name, schema, buffer_manager);
+  table->truncate();
+  page_id = 0;
+  current_page = table->new_page(page_id);
+}
+
+void TableSink::consume(const RowArena &rows) {
+  for (size_t i = 0; i < rows.size(); ++i) {
+    RowRef row = rows[i];
+    if (!current_page->can_fit(row)) {
+      table->write_page(current_page);
+      page_id++;
+      table->set_total_pages(page_id);
+      current_page = table->new_page(page_id);
+    }
+    current_page->add_row(row);
+  }
+}
+
+void TableSink::close() {
+  if (!current_page->rows.empty()) {
+    table->write_page(current_page);
+    page_id++;
+    current_page = table->new_page(page_id);
+  }
+  table->set_total_pages(page_id);
+  // The output is on disk when the join returns, so its writes count in
+  // the join's I/O rather than in whatever flushes the pool later
+  buffer_manager->flush(table->get_table_id());
+}
+
+} // namespace JoinOperations
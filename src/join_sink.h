@@ -0,0 +1,68 @@
+#ifndef JOIN_SINK_H
+#define JOIN_SINK_H
+
+#include "row_arena.h"
+#include "schema.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class BufferManager;
+class Page;
+class Table;
+
+namespace JoinOperations {
+
+// Join output is handed to the sink in batches of this many rows
+const size_t OUTPUT_BATCH_ROWS = 256;
+
+// Receives join output in batches as matches are found, so the join never
+// holds its whole result. A join calls open() once with the output schema,
+// consume() for every batch, then close().
+class JoinSink {
+public:
+  virtual ~JoinSink() = default;
+
+  virtual void open(const Schema &) {}
+  // Rows are encoded in the output schema and only valid during the call;
+  // the caller reuses the batch afterwards
+  virtual void consume(const RowArena &rows) = 0;
+  virtual void close() {}
+};
+
+// Keeps every row in memory, decoded
+class CollectSink : public JoinSink {
+private:
+  Schema schema;
+
+public:
+  std::vector<Row> rows;
+
+  void open(const Schema &output_schema) override;
+  void consume(const RowArena &batch) override;
+};
+
+// Packs rows into pages of a new table and hands each page to the buffer
+// pool as soon as it fills, so memory stays bounded by the pool. close()
+// writes the table's dirty pages to disk.
+class TableSink : public JoinSink {
+private:
+  std::string table_name;
+  std::shared_ptr<BufferManager> buffer_manager;
+  std::shared_ptr<Table> table;
+  std::shared_ptr<Page> current_page;
+  int page_id;
+
+public:
+  TableSink(const std::string &name, std::shared_ptr<BufferManager> bm);
+
+  void open(const Schema &schema) override;
+  void consume(const RowArena &rows) override;
+  void close() override;
+
+  std::shared_ptr<Table> get_table() const { return table; }
+};
+
+} // namespace JoinOperations
+
+#endif // JOIN_SINK_H
@@ -0,0 +1,41 @@
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return;
+  }
+
+  // mmap rejects a zero length, and an empty file has nothing to map
+  if (st.st_size > 0) {
+    void *mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size),
+                           PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(fd);
+      return;
+    }
+    ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char *>(mapping);
+    length = static_cast<size_t>(st.st_size);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+  opened = true;
+}
+
+MappedFile::~MappedFile() {
+  if (length > 0) {
+    ::munmap(const_cast<char *>(data), length);
+  }
+}
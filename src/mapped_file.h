@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. The contents are read straight
+// from the page cache, so parsers can hand out views into them instead of
+// copying lines and fields.
+class MappedFile {
+private:
+  const char *data = nullptr;
+  size_t length = 0;
+  bool opened = false;
+
+public:
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool is_open() const { return opened; }
+  // Empty for an empty file; valid until the mapping is destroyed
+  std::string_view contents() const { return {data, length}; }
+};
+
+#endif // MAPPED_FILE_H
@@ -1,120 +1,371 @@
 #include "parser.h"
 #include "buffer_manager.h"
+#include "mapped_file.h"
+#include "row_arena.h"
 #include "table.h"
+#include "table_stats.h"
 #include <algorithm>
-#include <fstream>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
-std::vector<std::string> CSVParser::split_csv_line(const std::string &line) {
-  std::vector<std::string> tokens;
-  std::stringstream ss(line);
-  std::string token;
+namespace {
 
-  while (std::getline(ss, token, ',')) {
-    tokens.push_back(trim(token));
+// Bytes of CSV text parsed as one unit. Each range ends at the first newline
+// after this many bytes, so no line is split.
+const size_t LOAD_RANGE_BYTES = 4 << 20;
+
+std::vector<std::string_view> split_ranges(std::string_view text) {
+  std::vector<std::string_view> ranges;
+  while (!text.empty()) {
+    size_t length = text.size();
+    if (length > LOAD_RANGE_BYTES) {
+      const char *start = text.data() + LOAD_RANGE_BYTES - 1;
+      const char *newline = static_cast<const char *>(
+          std::memchr(start, '\n', text.data() + text.size() - start));
+      if (newline) {
+        length = newline - text.data() + 1;
+      }
+    }
+    ranges.push_back(text.substr(0, length));
+    text.remove_prefix(length);
   }
+  return ranges;
+}
+
+// Rows parsed from one range by a loader thread, with their statistics and
+// the warnings to print when the range's turn comes
+struct ParsedRange {
+  RowArena rows;
+  std::unique_ptr<StatsCollector> stats;
+  std::string warnings;
+  std::exception_ptr error;
+};
+
+// Bounded hand-off of parsed ranges from one loader thread to the thread
+// writing pages
+class RangeQueue {
+private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<ParsedRange> ranges;
+  size_t capacity;
+  bool closed = false;
 
-  return tokens;
+public:
+  explicit RangeQueue(size_t max_ranges) : capacity(max_ranges) {}
+
+  // False once the queue is closed
+  bool push(ParsedRange range) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return closed || ranges.size() < capacity; });
+    if (closed) {
+      return false;
+    }
+    ranges.push_back(std::move(range));
+    cv.notify_all();
+    return true;
+  }
+
+  void pop(ParsedRange &range) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !ranges.empty(); });
+    range = std::move(ranges.front());
+    ranges.pop_front();
+    cv.notify_all();
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    cv.notify_all();
+  }
+};
+
+} // namespace
+
+bool CSVParser::next_line(std::string_view &text, std::string_view &line) {
+  if (text.empty()) {
+    return false;
+  }
+  const char *newline =
+      static_cast<const char *>(std::memchr(text.data(), '\n', text.size()));
+  size_t length = newline ? newline - text.data() : text.size();
+  line = text.substr(0, length);
+  text.remove_prefix(newline ? length + 1 : length);
+  return true;
 }
 
-std::string CSVParser::trim(const std::string &str) {
+void CSVParser::split_csv_line(std::string_view line,
+                               std::vector<std::string_view> &fields) {
+  fields.clear();
+  // A trailing comma does not start another field
+  while (!line.empty()) {
+    const char *comma =
+        static_cast<const char *>(std::memchr(line.data(), ',', line.size()));
+    if (!comma) {
+      fields.push_back(trim(line));
+      break;
+    }
+    size_t length = comma - line.data();
+    fields.push_back(trim(line.substr(0, length)));
+    line.remove_prefix(length + 1);
+  }
+}
+
+std::string_view CSVParser::trim(std::string_view str) {
   size_t first = str.find_first_not_of(" \t\r\n");
-  if (first == std::string::npos) {
-    return "";
+  if (first == std::string_view::npos) {
+    return {};
   }
 
   size_t last = str.find_last_not_of(" \t\r\n");
   return str.substr(first, (last - first + 1));
 }
 
+Schema CSVParser::uva_schema() {
+  return Schema({{"uva_id", ColumnType::Int64},
+                 {"nome", ColumnType::VarString},
+                 {"tipo", ColumnType::VarString},
+                 {"ano_colheita", ColumnType::Int64},
+                 {"pais_origem_id", ColumnType::Int64}});
+}
+
+Schema CSVParser::vinho_schema() {
+  return Schema({{"vinho_id", ColumnType::Int64},
+                 {"rotulo", ColumnType::VarString},
+                 {"ano_producao", ColumnType::Int64},
+                 {"uva_id", ColumnType::Int64},
+                 {"pais_producao_id", ColumnType::Int64}});
+}
+
+Schema CSVParser::pais_schema() {
+  return Schema({{"pais_id", ColumnType::Int64},
+                 {"nome", ColumnType::VarString},
+                 {"sigla", ColumnType::FixedString, 3}});
+}
+
 std::shared_ptr<Table>
 CSVParser::parse_uva_csv(const std::string &filename,
-                         std::shared_ptr<BufferManager> buffer_manager) {
-  std::vector<std::string> columns = {"uva_id", "nome", "tipo", "ano_colheita",
-                                      "pais_origem_id"};
-  return parse_csv(filename, "Uva", columns, buffer_manager);
+                         std::shared_ptr<BufferManager> buffer_manager,
+                         size_t threads) {
+  return parse_csv(filename, "Uva", uva_schema(), buffer_manager, threads);
 }
 
 std::shared_ptr<Table>
 CSVParser::parse_vinho_csv(const std::string &filename,
-                           std::shared_ptr<BufferManager> buffer_manager) {
-  std::vector<std::string> columns = {"vinho_id", "rotulo", "ano_producao",
-                                      "uva_id", "pais_producao_id"};
-  return parse_csv(filename, "Vinho", columns, buffer_manager);
+                           std::shared_ptr<BufferManager> buffer_manager,
+                           size_t threads) {
+  return parse_csv(filename, "Vinho", vinho_schema(), buffer_manager, threads);
 }
 
 std::shared_ptr<Table>
 CSVParser::parse_pais_csv(const std::string &filename,
-                          std::shared_ptr<BufferManager> buffer_manager) {
-  std::vector<std::string> columns = {"pais_id", "nome", "sigla"};
-  return parse_csv(filename, "Pais", columns, buffer_manager);
+                          std::shared_ptr<BufferManager> buffer_manager,
+                          size_t threads) {
+  return parse_csv(filename, "Pais", pais_schema(), buffer_manager, threads);
 }
 
 std::shared_ptr<Table>
 CSVParser::parse_csv(const std::string &filename, const std::string &table_name,
                      const std::vector<std::string> &expected_columns,
-                     std::shared_ptr<BufferManager> buffer_manager) {
-  std::ifstream file(filename);
+                     std::shared_ptr<BufferManager> buffer_manager,
+                     size_t threads) {
+  MappedFile file(filename);
   if (!file.is_open()) {
     throw std::runtime_error("Cannot open CSV file: " + filename);
   }
 
-  auto table =
-      std::make_shared<Table>(table_name, expected_columns, buffer_manager);
-
-  std::string line;
+  // First pass: observe every well-formed data row
+  std::vector<ColumnTypeInference> inference(expected_columns.size());
+  std::string_view text = file.contents();
+  std::string_view line;
+  std::vector<std::string_view> tokens;
   bool first_line = true;
-  int current_page_id = 0;
-  auto current_page = std::make_shared<Page>(current_page_id);
 
-  while (std::getline(file, line)) {
+  while (next_line(text, line)) {
     if (line.empty())
       continue;
 
     if (first_line) {
-      // Validate header line
-      auto header_tokens = split_csv_line(line);
+      first_line = false;
+      continue;
+    }
 
-      if (header_tokens.size() != expected_columns.size()) {
-        std::cerr << "Warning: Header has " << header_tokens.size()
-                  << " columns, expected " << expected_columns.size()
-                  << std::endl;
-      }
+    split_csv_line(line, tokens);
+    if (tokens.size() != expected_columns.size())
+      continue;
 
-      // Optional: Check if header matches expected columns
-      for (size_t i = 0;
-           i < std::min(header_tokens.size(), expected_columns.size()); ++i) {
-        if (header_tokens[i] != expected_columns[i]) {
-          std::cerr << "Warning: Column " << i << " header '"
-                    << header_tokens[i] << "' doesn't match expected '"
-                    << expected_columns[i] << "'" << std::endl;
-        }
-      }
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      inference[i].observe(tokens[i]);
+    }
+  }
 
-      first_line = false;
+  std::vector<Column> columns;
+  for (size_t i = 0; i < expected_columns.size(); ++i) {
+    columns.push_back(inference[i].result(expected_columns[i]));
+  }
+
+  return parse_csv(filename, table_name, Schema(columns), buffer_manager,
+                   threads);
+}
+
+void CSVParser::parse_rows(std::string_view text, const Schema &schema,
+                           RowArena &rows, StatsCollector &stats,
+                           std::ostream &warnings) {
+  std::string_view line;
+  std::vector<std::string_view> tokens;
+
+  while (next_line(text, line)) {
+    if (line.empty())
       continue;
-    }
 
-    // Parse data line
-    auto tokens = split_csv_line(line);
+    split_csv_line(line, tokens);
+    if (tokens.size() != schema.size()) {
+      warnings << "Warning: Row has " << tokens.size() << " columns, expected "
+               << schema.size() << std::endl;
+      continue;
+    }
 
-    if (tokens.size() != expected_columns.size()) {
-      std::cerr << "Warning: Row has " << tokens.size() << " columns, expected "
-                << expected_columns.size() << std::endl;
+    // Fields go from the mapping straight into the row encoding
+    size_t i = rows.append_text(schema, tokens);
+    if (i < schema.size()) {
+      warnings << "Warning: Value '" << tokens[i] << "' is not a valid "
+               << column_type_name(schema[i].type) << " for column "
+               << schema[i].name << std::endl;
       continue;
     }
 
-    Row row(tokens);
+    stats.observe(rows.back());
+  }
+}
 
-    if (current_page->is_full()) {
-      // Write current page and create new one
-      table->write_page(current_page);
-      current_page_id++;
-      current_page = std::make_shared<Page>(current_page_id);
+std::shared_ptr<Table>
+CSVParser::parse_csv(const std::string &filename, const std::string &table_name,
+                     const Schema &schema,
+                     std::shared_ptr<BufferManager> buffer_manager,
+                     size_t threads) {
+  MappedFile file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Cannot open CSV file: " + filename);
+  }
+
+  const std::vector<std::string> &expected_columns = schema.get_column_names();
+  auto table = std::make_shared<Table>(table_name, schema, buffer_manager);
+  table->truncate();
+
+  // Validate header line
+  std::string_view text = file.contents();
+  std::string_view line;
+  while (next_line(text, line) && line.empty()) {
+  }
+  if (!line.empty()) {
+    std::vector<std::string_view> header_tokens;
+    split_csv_line(line, header_tokens);
+
+    if (header_tokens.size() != expected_columns.size()) {
+      std::cerr << "Warning: Header has " << header_tokens.size()
+                << " columns, expected " << expected_columns.size()
+                << std::endl;
     }
 
-    current_page->add_row(row);
+    // Optional: Check if header matches expected columns
+    for (size_t i = 0;
+         i < std::min(header_tokens.size(), expected_columns.size()); ++i) {
+      if (header_tokens[i] != expected_columns[i]) {
+        std::cerr << "Warning: Column " << i << " header '" << header_tokens[i]
+                  << "' doesn't match expected '" << expected_columns[i] << "'"
+                  << std::endl;
+      }
+    }
+  }
+
+  int current_page_id = 0;
+  auto current_page = table->new_page(current_page_id);
+  StatsCollector stats(schema);
+
+  // Pages are packed here in file order, whichever thread parsed the rows,
+  // so the table is the same for any number of threads
+  auto write_rows = [&](RowArena &rows) {
+    for (size_t i = 0; i < rows.size(); ++i) {
+      RowRef row = rows[i];
+      if (!current_page->can_fit(row)) {
+        // Write current page and create new one
+        table->write_page(current_page);
+        current_page_id++;
+        current_page = table->new_page(current_page_id);
+      }
+      current_page->add_row(row);
+    }
+    rows.clear();
+  };
+
+  std::vector<std::string_view> ranges = split_ranges(text);
+  threads = std::max<size_t>(1, std::min(threads, ranges.size()));
+
+  if (threads == 1) {
+    RowArena rows;
+    for (std::string_view range : ranges) {
+      parse_rows(range, schema, rows, stats, std::cerr);
+      write_rows(rows);
+    }
+  } else {
+    // Worker w parses ranges w, w + threads, ... and queues them in that
+    // order, so taking ranges from the queues in turn restores file order
+    std::vector<std::unique_ptr<RangeQueue>> queues;
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < threads; ++w) {
+      queues.push_back(std::make_unique<RangeQueue>(2));
+    }
+    for (size_t w = 0; w < threads; ++w) {
+      workers.emplace_back([&, w] {
+        for (size_t r = w; r < ranges.size(); r += threads) {
+          ParsedRange parsed;
+          try {
+            parsed.stats = std::make_unique<StatsCollector>(schema);
+            std::ostringstream warnings;
+            parse_rows(ranges[r], schema, parsed.rows, *parsed.stats,
+                       warnings);
+            parsed.warnings = warnings.str();
+          } catch (...) {
+            parsed.error = std::current_exception();
+          }
+          if (!queues[w]->push(std::move(parsed))) {
+            return; // The writer gave up
+          }
+        }
+      });
+    }
+
+    std::exception_ptr error;
+    try {
+      for (size_t r = 0; r < ranges.size(); ++r) {
+        ParsedRange parsed;
+        queues[r % threads]->pop(parsed);
+        if (parsed.error) {
+          std::rethrow_exception(parsed.error);
+        }
+        std::cerr << parsed.warnings;
+        stats.merge(std::move(*parsed.stats));
+        write_rows(parsed.rows);
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    for (auto &queue : queues) {
+      queue->close();
+    }
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
   }
 
   // Write the last page if it has data
@@ -124,7 +375,8 @@ CSVParser::parse_csv(const std::string &filename, const std::string &table_name,
   }
 
   table->set_total_pages(current_page_id);
-  file.close();
+  table->set_sort_column(stats.sort_column());
+  table->set_stats(std::make_shared<TableStats>(stats.result()));
 
   return table;
 }
@@ -1,36 +1,71 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include "schema.h"
+#include <iosfwd>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Table;
 class BufferManager;
+class RowArena;
+class StatsCollector;
 
 class CSVParser {
 private:
-  static std::vector<std::string> split_csv_line(const std::string &line);
-  static std::string trim(const std::string &str);
+  // Cuts the next line, without its '\n', off the front of text
+  static bool next_line(std::string_view &text, std::string_view &line);
+  // Splits a line on commas into trimmed views of it, reusing fields
+  static void split_csv_line(std::string_view line,
+                             std::vector<std::string_view> &fields);
+  static std::string_view trim(std::string_view str);
+  // Parses the data lines of text and appends the rows, encoded, to rows,
+  // writing a warning for each row it skips
+  static void parse_rows(std::string_view text, const Schema &schema,
+                         RowArena &rows, StatsCollector &stats,
+                         std::ostream &warnings);
 
 public:
+  // Schemas of the bundled tables
+  static Schema uva_schema();
+  static Schema vinho_schema();
+  static Schema pais_schema();
+
   static std::shared_ptr<Table>
   parse_uva_csv(const std::string &filename,
-                std::shared_ptr<BufferManager> buffer_manager);
+                std::shared_ptr<BufferManager> buffer_manager,
+                size_t threads = 1);
 
   static std::shared_ptr<Table>
   parse_vinho_csv(const std::string &filename,
-                  std::shared_ptr<BufferManager> buffer_manager);
+                  std::shared_ptr<BufferManager> buffer_manager,
+                  size_t threads = 1);
 
   static std::shared_ptr<Table>
   parse_pais_csv(const std::string &filename,
-                 std::shared_ptr<BufferManager> buffer_manager);
+                 std::shared_ptr<BufferManager> buffer_manager,
+                 size_t threads = 1);
+
+  // Generic CSV parser. The file is memory-mapped and fields stay views into
+  // the mapping until they are converted to the schema's column types; rows
+  // with a value that does not parse are skipped with a warning. The table's
+  // statistics and sort column are gathered as rows are written.
+  // With more than one thread, the file is cut into ranges at line breaks
+  // and the ranges are parsed concurrently; pages are still written in file
+  // order, so the table does not depend on the thread count.
+  static std::shared_ptr<Table>
+  parse_csv(const std::string &filename, const std::string &table_name,
+            const Schema &schema, std::shared_ptr<BufferManager> buffer_manager,
+            size_t threads = 1);
 
-  // Generic CSV parser
+  // Same, but infers each column's type from a first pass over the file
   static std::shared_ptr<Table>
   parse_csv(const std::string &filename, const std::string &table_name,
             const std::vector<std::string> &expected_columns,
-            std::shared_ptr<BufferManager> buffer_manager);
+            std::shared_ptr<BufferManager> buffer_manager,
+            size_t threads = 1);
 };
 
 #endif // PARSER_H
@@ -0,0 +1,154 @@
+#include "pipeline_join.h"
+#include "buffer_manager.h"
+#include "hash_join.h"
+#include "table.h"
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+namespace JoinOperations {
+
+namespace {
+
+const size_t NO_ROW = SIZE_MAX;
+
+// Passes a hash join's output on to the pipeline's own output, which was
+// opened already
+class ForwardSink : public JoinSink {
+private:
+  std::function<void(const RowArena &)> forward;
+
+public:
+  explicit ForwardSink(std::function<void(const RowArena &)> f)
+      : forward(std::move(f)) {}
+
+  void consume(const RowArena &rows) override { forward(rows); }
+};
+
+} // namespace
+
+PipelineJoinSink::PipelineJoinSink(std::shared_ptr<Table> joined_table,
+                                   const std::string &stream_column_name,
+                                   const std::string &table_column_name,
+                                   std::shared_ptr<BufferManager> bm,
+                                   JoinSink &next_sink)
+    : table(std::move(joined_table)), stream_column(stream_column_name),
+      table_column(table_column_name), buffer_manager(std::move(bm)),
+      next(next_sink) {}
+
+Schema PipelineJoinSink::output_schema(const Schema &stream_schema,
+                                       const Table &joined_table) {
+  std::string prefix;
+  for (char c : joined_table.get_name()) {
+    prefix += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  prefix += "_";
+
+  std::vector<Column> columns = stream_schema.get_columns();
+  for (const Column &col : joined_table.get_schema().get_columns()) {
+    columns.emplace_back(prefix + col.name, col.type, col.length);
+  }
+  return Schema(columns);
+}
+
+void PipelineJoinSink::open(const Schema &schema) {
+  stream_schema = schema;
+  stream_col_idx = stream_schema.get_column_index(stream_column);
+  table_col_idx = table->get_column_index(table_column);
+  if (stream_col_idx == -1 || table_col_idx == -1) {
+    throw std::runtime_error("Join column not found in pipeline stage");
+  }
+  numeric_as_double =
+      hash_key_needs_double(stream_schema[stream_col_idx].type,
+                            table->get_schema()[table_col_idx].type);
+  row_count = 0;
+  next.open(output_schema(stream_schema, *table));
+
+  const size_t memory_pages =
+      std::max<size_t>(2, buffer_manager->get_sort_buffer_pages());
+  if (static_cast<size_t>(table->get_total_pages()) > memory_pages) {
+    std::cout << "Pipeline: " << table->get_name()
+              << " does not fit in memory, spilling the stream" << std::endl;
+    stream_spill = std::make_unique<SpillTable>(
+        table->get_name() + "_pipeline_stream", stream_schema,
+        buffer_manager);
+    return;
+  }
+
+  const Schema &table_schema = table->get_schema();
+  auto iter = table->get_iterator(AccessHint::Sequential);
+  while (iter.has_next()) {
+    RowRef row = iter.next_ref();
+    std::string key = hash_join_key(
+        table_schema.column_value(row, table_col_idx), numeric_as_double);
+    size_t index = table_rows.size();
+    table_rows.append(row);
+    next_row.push_back(NO_ROW);
+    auto [it, inserted] = hash_table.try_emplace(std::move(key), index, index);
+    if (!inserted) {
+      next_row[it->second.second] = index;
+      it->second.second = index;
+    }
+  }
+}
+
+void PipelineJoinSink::consume(const RowArena &rows) {
+  for (size_t i = 0; i < rows.size(); ++i) {
+    if (stream_spill) {
+      stream_spill->add(rows[i]);
+      continue;
+    }
+    std::string key = hash_join_key(
+        stream_schema.column_value(rows[i], stream_col_idx),
+        numeric_as_double);
+    auto it = hash_table.find(key);
+    if (it == hash_table.end()) {
+      continue;
+    }
+    for (size_t index = it->second.first; index != NO_ROW;
+         index = next_row[index]) {
+      emit(rows[i], table_rows[index]);
+    }
+  }
+}
+
+void PipelineJoinSink::emit(RowRef stream_row, RowRef table_row) {
+  batch.append(stream_row, table_row);
+  ++row_count;
+  if (batch.size() >= OUTPUT_BATCH_ROWS) {
+    flush();
+  }
+}
+
+void PipelineJoinSink::flush() {
+  if (!batch.empty()) {
+    next.consume(batch);
+    batch.clear();
+  }
+}
+
+void PipelineJoinSink::close() {
+  flush();
+  if (stream_spill) {
+    // Join output already has the stream's columns and then the table's,
+    // so its rows pass through unchanged
+    std::shared_ptr<Table> stream_table = stream_spill->finish();
+    stream_spill.reset();
+    ForwardSink forward([this](const RowArena &rows) {
+      row_count += rows.size();
+      next.consume(rows);
+    });
+    hash_join(stream_table, table, stream_column, table_column,
+              buffer_manager, forward);
+    stream_table->drop();
+  }
+
+  hash_table.clear();
+  next_row.clear();
+  table_rows = RowArena();
+  next.close();
+}
+
+} // namespace JoinOperations
@@ -0,0 +1,72 @@
+#ifndef PIPELINE_JOIN_H
+#define PIPELINE_JOIN_H
+
+#include "join_sink.h"
+#include "spill_table.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class BufferManager;
+class Table;
+
+namespace JoinOperations {
+
+// One more join stage fed by another join: the rows streaming in are joined
+// with a table and the combined rows go on to the next sink, so a chain of
+// joins such as Vinho ⋈ Uva ⋈ Pais never materializes an intermediate
+// result. Output rows have the stream's columns first, then the table's
+// prefixed with its lower-cased name.
+//
+// When the table fits in the sort grant it is loaded into a hash table on
+// open() and each incoming row probes it at once, which also keeps the
+// stream's order. Otherwise the stream is spilled through the buffer pool
+// and joined with the table by hash_join on close().
+class PipelineJoinSink : public JoinSink {
+private:
+  std::shared_ptr<Table> table;
+  std::string stream_column;
+  std::string table_column;
+  std::shared_ptr<BufferManager> buffer_manager;
+  JoinSink &next;
+
+  Schema stream_schema;
+  int stream_col_idx = -1;
+  int table_col_idx = -1;
+  bool numeric_as_double = false;
+
+  // Table rows by key: first and last row of each key in table_rows, with
+  // next_row chaining the rows of a key in table order
+  RowArena table_rows;
+  std::vector<size_t> next_row;
+  std::unordered_map<std::string, std::pair<size_t, size_t>> hash_table;
+  std::unique_ptr<SpillTable> stream_spill;
+
+  RowArena batch;
+  size_t row_count = 0;
+
+  void emit(RowRef stream_row, RowRef table_row);
+  void flush();
+
+public:
+  PipelineJoinSink(std::shared_ptr<Table> joined_table,
+                   const std::string &stream_column_name,
+                   const std::string &table_column_name,
+                   std::shared_ptr<BufferManager> bm, JoinSink &next_sink);
+
+  void open(const Schema &schema) override;
+  void consume(const RowArena &rows) override;
+  void close() override;
+
+  // Rows passed to the next sink
+  size_t get_row_count() const { return row_count; }
+
+  static Schema output_schema(const Schema &stream_schema,
+                              const Table &joined_table);
+};
+
+} // namespace JoinOperations
+
+#endif // PIPELINE_JOIN_H
@@ -0,0 +1,294 @@
+#include "replacement_policy.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+std::unique_ptr<ReplacementPolicy>
+make_replacement_policy(ReplacementPolicyType type, size_t pool_size) {
+  switch (type) {
+  case ReplacementPolicyType::LRU:
+    return std::make_unique<LruPolicy>(pool_size);
+  case ReplacementPolicyType::LRU_K:
+    return std::make_unique<LruKPolicy>(pool_size);
+  case ReplacementPolicyType::TwoQ:
+    return std::make_unique<TwoQPolicy>(pool_size);
+  case ReplacementPolicyType::Clock:
+    return std::make_unique<ClockPolicy>(pool_size);
+  }
+  throw std::runtime_error("Unknown replacement policy");
+}
+
+ReplacementPolicyType parse_replacement_policy(const std::string &name) {
+  std::string lower = name;
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (lower == "lru") {
+    return ReplacementPolicyType::LRU;
+  }
+  if (lower == "lru-k" || lower == "lruk" || lower == "lru2") {
+    return ReplacementPolicyType::LRU_K;
+  }
+  if (lower == "2q") {
+    return ReplacementPolicyType::TwoQ;
+  }
+  if (lower == "clock") {
+    return ReplacementPolicyType::Clock;
+  }
+  throw std::runtime_error("Unknown replacement policy: " + name);
+}
+
+// FrameList implementation
+void FrameList::push_front(size_t id) {
+  prev[id] = NIL;
+  next[id] = head_id;
+  if (head_id != NIL) {
+    prev[head_id] = id;
+  }
+  head_id = id;
+  if (tail_id == NIL) {
+    tail_id = id;
+  }
+  linked[id] = true;
+  count++;
+}
+
+void FrameList::push_back(size_t id) {
+  next[id] = NIL;
+  prev[id] = tail_id;
+  if (tail_id != NIL) {
+    next[tail_id] = id;
+  }
+  tail_id = id;
+  if (head_id == NIL) {
+    head_id = id;
+  }
+  linked[id] = true;
+  count++;
+}
+
+void FrameList::unlink(size_t id) {
+  if (!linked[id]) {
+    return;
+  }
+  if (prev[id] != NIL) {
+    next[prev[id]] = next[id];
+  } else {
+    head_id = next[id];
+  }
+  if (next[id] != NIL) {
+    prev[next[id]] = prev[id];
+  } else {
+    tail_id = prev[id];
+  }
+  prev[id] = next[id] = NIL;
+  linked[id] = false;
+  count--;
+}
+
+// LRU implementation
+void LruPolicy::record_insert(size_t frame_id, uint64_t, AccessHint hint) {
+  if (hint == AccessHint::Sequential) {
+    list.push_back(frame_id);
+  } else {
+    list.push_front(frame_id);
+  }
+}
+
+void LruPolicy::record_access(size_t frame_id, AccessHint hint) {
+  // A scan touches each page once, so its pages are moved to the cold end
+  list.unlink(frame_id);
+  if (hint == AccessHint::Sequential) {
+    list.push_back(frame_id);
+  } else {
+    list.push_front(frame_id);
+  }
+}
+
+void LruPolicy::remove(size_t frame_id, bool) { list.unlink(frame_id); }
+
+size_t
+LruPolicy::pick_victim(const std::function<bool(size_t)> &evictable) {
+  for (size_t id = list.tail(); id != FrameList::NIL; id = list.prev_of(id)) {
+    if (evictable(id)) {
+      return id;
+    }
+  }
+  return NO_FRAME;
+}
+
+// LRU-K implementation
+LruKPolicy::LruKPolicy(size_t pool_size, size_t k_value)
+    : k(std::max<size_t>(1, k_value)), clock(0),
+      history(pool_size, std::vector<uint64_t>(k, 0)),
+      access_count(pool_size, 0), resident(pool_size, false) {}
+
+void LruKPolicy::record(size_t frame_id, uint64_t timestamp) {
+  history[frame_id][access_count[frame_id] % k] = timestamp;
+  access_count[frame_id]++;
+}
+
+void LruKPolicy::record_insert(size_t frame_id, uint64_t, AccessHint hint) {
+  resident[frame_id] = true;
+  access_count[frame_id] = 0;
+  // A sequential page looks older than anything else in the pool
+  record(frame_id, hint == AccessHint::Sequential ? 0 : ++clock);
+}
+
+void LruKPolicy::record_access(size_t frame_id, AccessHint hint) {
+  if (hint == AccessHint::Normal) {
+    record(frame_id, ++clock);
+  }
+}
+
+void LruKPolicy::remove(size_t frame_id, bool) {
+  resident[frame_id] = false;
+  access_count[frame_id] = 0;
+}
+
+size_t
+LruKPolicy::pick_victim(const std::function<bool(size_t)> &evictable) {
+  size_t victim = NO_FRAME;
+  bool victim_infinite = false;
+  uint64_t victim_time = 0;
+
+  for (size_t id = 0; id < resident.size(); ++id) {
+    if (!resident[id] || !evictable(id)) {
+      continue;
+    }
+
+    // Frames with fewer than k references have infinite backward distance
+    // and are ordered by their first reference
+    bool infinite = access_count[id] < k;
+    uint64_t time = infinite ? history[id][0]
+                             : history[id][(access_count[id] - k) % k];
+
+    bool better = victim == NO_FRAME || (infinite && !victim_infinite) ||
+                  (infinite == victim_infinite && time < victim_time);
+    if (better) {
+      victim = id;
+      victim_infinite = infinite;
+      victim_time = time;
+    }
+  }
+
+  return victim;
+}
+
+// 2Q implementation
+TwoQPolicy::TwoQPolicy(size_t pool_size)
+    : kin(std::max<size_t>(1, pool_size / 4)),
+      kout(std::max<size_t>(1, pool_size / 2)), a1in(pool_size), am(pool_size),
+      frame_keys(pool_size, 0), sequential(pool_size, false) {}
+
+void TwoQPolicy::remember(uint64_t key) {
+  a1out.push_front(key);
+  a1out_index[key] = a1out.begin();
+  if (a1out.size() > kout) {
+    a1out_index.erase(a1out.back());
+    a1out.pop_back();
+  }
+}
+
+void TwoQPolicy::record_insert(size_t frame_id, uint64_t key,
+                               AccessHint hint) {
+  frame_keys[frame_id] = key;
+  sequential[frame_id] = hint == AccessHint::Sequential;
+
+  auto ghost = a1out_index.find(key);
+  if (ghost != a1out_index.end()) {
+    a1out.erase(ghost->second);
+    a1out_index.erase(ghost);
+    if (!sequential[frame_id]) {
+      am.push_front(frame_id);
+      return;
+    }
+  }
+
+  if (sequential[frame_id]) {
+    a1in.push_back(frame_id);
+  } else {
+    a1in.push_front(frame_id);
+  }
+}
+
+void TwoQPolicy::record_access(size_t frame_id, AccessHint hint) {
+  // References while still in A1in are treated as correlated and ignored
+  if (hint == AccessHint::Normal && am.contains(frame_id) &&
+      am.head() != frame_id) {
+    am.unlink(frame_id);
+    am.push_front(frame_id);
+  }
+}
+
+void TwoQPolicy::remove(size_t frame_id, bool evicted) {
+  if (a1in.contains(frame_id)) {
+    a1in.unlink(frame_id);
+    if (evicted && !sequential[frame_id]) {
+      remember(frame_keys[frame_id]);
+    }
+  } else {
+    am.unlink(frame_id);
+  }
+}
+
+size_t
+TwoQPolicy::victim_from(const FrameList &list,
+                        const std::function<bool(size_t)> &evictable) const {
+  for (size_t id = list.tail(); id != FrameList::NIL; id = list.prev_of(id)) {
+    if (evictable(id)) {
+      return id;
+    }
+  }
+  return NO_FRAME;
+}
+
+size_t
+TwoQPolicy::pick_victim(const std::function<bool(size_t)> &evictable) {
+  if (a1in.size() > kin) {
+    size_t victim = victim_from(a1in, evictable);
+    return victim != NO_FRAME ? victim : victim_from(am, evictable);
+  }
+
+  size_t victim = victim_from(am, evictable);
+  return victim != NO_FRAME ? victim : victim_from(a1in, evictable);
+}
+
+// CLOCK implementation
+void ClockPolicy::record_insert(size_t frame_id, uint64_t, AccessHint hint) {
+  resident[frame_id] = true;
+  referenced[frame_id] = hint == AccessHint::Normal;
+}
+
+void ClockPolicy::record_access(size_t frame_id, AccessHint hint) {
+  if (hint == AccessHint::Normal) {
+    referenced[frame_id] = true;
+  }
+}
+
+void ClockPolicy::remove(size_t frame_id, bool) {
+  resident[frame_id] = false;
+  referenced[frame_id] = false;
+}
+
+size_t
+ClockPolicy::pick_victim(const std::function<bool(size_t)> &evictable) {
+  const size_t frames = resident.size();
+
+  // Two sweeps are enough: the first clears every reference bit it passes
+  for (size_t step = 0; step < 2 * frames; ++step) {
+    size_t id = hand;
+    hand = (hand + 1) % frames;
+
+    if (!resident[id] || !evictable(id)) {
+      continue;
+    }
+    if (referenced[id]) {
+      referenced[id] = false;
+      continue;
+    }
+    return id;
+  }
+
+  return NO_FRAME;
+}
@@ -0,0 +1,161 @@
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How the caller expects to use a page. Sequential pages are read once by a
+// scan, so policies place them at the cold end instead of letting them push
+// out pages that are reused.
+enum class AccessHint { Normal, Sequential };
+
+enum class ReplacementPolicyType { LRU, LRU_K, TwoQ, Clock };
+
+// Tracks the frames of a buffer pool and decides which one to evict.
+// Frames are identified by their index in the pool; page keys are passed in
+// so policies can remember pages that are no longer resident.
+class ReplacementPolicy {
+public:
+  static constexpr size_t NO_FRAME = SIZE_MAX;
+
+  virtual ~ReplacementPolicy() = default;
+
+  virtual const char *name() const = 0;
+
+  // A frame was filled with page `key` after a miss
+  virtual void record_insert(size_t frame_id, uint64_t key,
+                             AccessHint hint) = 0;
+  // A resident frame was referenced again
+  virtual void record_access(size_t frame_id, AccessHint hint) = 0;
+  // A frame was emptied. `evicted` is false when the page was dropped
+  // without being chosen as a victim (e.g. its table was recreated).
+  virtual void remove(size_t frame_id, bool evicted) = 0;
+  // Picks the frame to evict among those accepted by `evictable`, or
+  // NO_FRAME if there is none
+  virtual size_t pick_victim(const std::function<bool(size_t)> &evictable) = 0;
+};
+
+std::unique_ptr<ReplacementPolicy>
+make_replacement_policy(ReplacementPolicyType type, size_t pool_size);
+
+ReplacementPolicyType parse_replacement_policy(const std::string &name);
+
+// Doubly linked list of frame ids stored in flat arrays, so moving a frame
+// never allocates. The head is the hot end, the tail the cold end.
+class FrameList {
+private:
+  std::vector<size_t> prev;
+  std::vector<size_t> next;
+  std::vector<bool> linked;
+  size_t head_id;
+  size_t tail_id;
+  size_t count;
+
+public:
+  static constexpr size_t NIL = SIZE_MAX;
+
+  explicit FrameList(size_t capacity)
+      : prev(capacity, NIL), next(capacity, NIL), linked(capacity, false),
+        head_id(NIL), tail_id(NIL), count(0) {}
+
+  bool contains(size_t id) const { return linked[id]; }
+  size_t size() const { return count; }
+  size_t head() const { return head_id; }
+  size_t tail() const { return tail_id; }
+  size_t prev_of(size_t id) const { return prev[id]; }
+
+  void push_front(size_t id);
+  void push_back(size_t id);
+  void unlink(size_t id);
+};
+
+class LruPolicy : public ReplacementPolicy {
+private:
+  FrameList list;
+
+public:
+  explicit LruPolicy(size_t pool_size) : list(pool_size) {}
+
+  const char *name() const override { return "LRU"; }
+  void record_insert(size_t frame_id, uint64_t key, AccessHint hint) override;
+  void record_access(size_t frame_id, AccessHint hint) override;
+  void remove(size_t frame_id, bool evicted) override;
+  size_t pick_victim(const std::function<bool(size_t)> &evictable) override;
+};
+
+// LRU-K evicts the frame whose K-th most recent reference is oldest. Frames
+// with fewer than K references count as infinitely old and are ordered by
+// their first reference.
+class LruKPolicy : public ReplacementPolicy {
+private:
+  size_t k;
+  uint64_t clock;
+  std::vector<std::vector<uint64_t>> history; // Ring of the last k accesses
+  std::vector<size_t> access_count;
+  std::vector<bool> resident;
+
+  void record(size_t frame_id, uint64_t timestamp);
+
+public:
+  LruKPolicy(size_t pool_size, size_t k = 2);
+
+  const char *name() const override { return "LRU-K"; }
+  void record_insert(size_t frame_id, uint64_t key, AccessHint hint) override;
+  void record_access(size_t frame_id, AccessHint hint) override;
+  void remove(size_t frame_id, bool evicted) override;
+  size_t pick_victim(const std::function<bool(size_t)> &evictable) override;
+};
+
+// Simplified 2Q: first references land in the A1in FIFO, pages referenced
+// again after leaving A1in (remembered in the A1out ghost queue) go to the
+// Am LRU list.
+class TwoQPolicy : public ReplacementPolicy {
+private:
+  size_t kin;  // Target size of A1in
+  size_t kout; // Capacity of the A1out ghost queue
+  FrameList a1in;
+  FrameList am;
+  std::vector<uint64_t> frame_keys;
+  std::vector<bool> sequential;
+  std::list<uint64_t> a1out;
+  std::unordered_map<uint64_t, std::list<uint64_t>::iterator> a1out_index;
+
+  void remember(uint64_t key);
+  size_t victim_from(const FrameList &list,
+                     const std::function<bool(size_t)> &evictable) const;
+
+public:
+  explicit TwoQPolicy(size_t pool_size);
+
+  const char *name() const override { return "2Q"; }
+  void record_insert(size_t frame_id, uint64_t key, AccessHint hint) override;
+  void record_access(size_t frame_id, AccessHint hint) override;
+  void remove(size_t frame_id, bool evicted) override;
+  size_t pick_victim(const std::function<bool(size_t)> &evictable) override;
+};
+
+// CLOCK approximates LRU with one reference bit per frame and a sweeping
+// hand.
+class ClockPolicy : public ReplacementPolicy {
+private:
+  std::vector<bool> resident;
+  std::vector<bool> referenced;
+  size_t hand;
+
+public:
+  explicit ClockPolicy(size_t pool_size)
+      : resident(pool_size, false), referenced(pool_size, false), hand(0) {}
+
+  const char *name() const override { return "CLOCK"; }
+  void record_insert(size_t frame_id, uint64_t key, AccessHint hint) override;
+  void record_access(size_t frame_id, AccessHint hint) override;
+  void remove(size_t frame_id, bool evicted) override;
+  size_t pick_victim(const std::function<bool(size_t)> &evictable) override;
+};
+
+#endif // REPLACEMENT_POLICY_H
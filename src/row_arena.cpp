@@ -0,0 +1,45 @@
+#include "row_arena.h"
+#include <cstring>
+
+char *RowArena::extend(size_t row_size) {
+  size_t offset = bytes.size();
+  offsets.push_back(offset);
+  bytes.resize(offset + row_size);
+  return bytes.data() + offset;
+}
+
+void RowArena::append(RowRef row) {
+  std::memcpy(extend(row.size), row.data, row.size);
+}
+
+void RowArena::append(RowRef left, RowRef right) {
+  char *dst = extend(left.size + right.size);
+  std::memcpy(dst, left.data, left.size);
+  std::memcpy(dst + left.size, right.data, right.size);
+}
+
+void RowArena::append(const Schema &schema, const Row &row) {
+  size_t row_size = schema.row_bytes(row);
+  schema.serialize_row(row, extend(row_size));
+}
+
+size_t RowArena::append_text(const Schema &schema,
+                             const std::vector<std::string_view> &fields) {
+  size_t bad_field =
+      schema.encode_text_row(fields, extend(schema.text_row_bytes(fields)));
+  if (bad_field < schema.size()) {
+    bytes.resize(offsets.back());
+    offsets.pop_back();
+  }
+  return bad_field;
+}
+
+void RowArena::reserve(size_t row_bytes, size_t rows) {
+  bytes.reserve(row_bytes);
+  offsets.reserve(rows);
+}
+
+void RowArena::clear() {
+  bytes.clear();
+  offsets.clear();
+}
@@ -0,0 +1,52 @@
+#ifndef ROW_ARENA_H
+#define ROW_ARENA_H
+
+#include "schema.h"
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Rows in a Schema's binary encoding, packed back to back in one buffer
+// with an offset array marking where each starts. Pages keep their rows in
+// one, and operators use them for batches and groups of rows they hold
+// briefly. A RowRef into an arena is valid until the next append or clear.
+// clear() keeps the memory, so an arena that is refilled stops allocating
+// once it has held its largest contents.
+class RowArena {
+private:
+  std::vector<char> bytes;
+  std::vector<size_t> offsets; // Start of each row; the last ends at size
+
+  char *extend(size_t row_size);
+
+public:
+  size_t size() const { return offsets.size(); }
+  bool empty() const { return offsets.empty(); }
+  size_t byte_size() const { return bytes.size(); }
+  const char *data() const { return bytes.data(); }
+
+  RowRef operator[](size_t index) const {
+    size_t end = index + 1 < offsets.size() ? offsets[index + 1]
+                                            : bytes.size();
+    return {bytes.data() + offsets[index], end - offsets[index]};
+  }
+  RowRef front() const { return (*this)[0]; }
+  RowRef back() const { return (*this)[offsets.size() - 1]; }
+
+  void append(RowRef row);
+  // Appends one row made of two encoded rows. The encoding has no row
+  // header, so this is the row of a join schema listing the left columns
+  // and then the right ones.
+  void append(RowRef left, RowRef right);
+  void append(const Schema &schema, const Row &row);
+  // Appends the row Schema::encode_text_row makes of CSV fields. Returns
+  // the index of the first field that does not parse, leaving the arena as
+  // it was, or schema.size() once the row is appended.
+  size_t append_text(const Schema &schema,
+                     const std::vector<std::string_view> &fields);
+
+  void reserve(size_t row_bytes, size_t rows);
+  void clear();
+};
+
+#endif // ROW_ARENA_H
@@ -0,0 +1,154 @@
+#include "scan_projection.h"
+#include "bloom_filter.h"
+#include "join_operation.h"
+#include <stdexcept>
+#include <string_view>
+
+namespace JoinOperations {
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+  size_t start = text.find_first_not_of(" \t");
+  if (start == std::string_view::npos) {
+    return {};
+  }
+  size_t end = text.find_last_not_of(" \t");
+  return text.substr(start, end - start + 1);
+}
+
+bool passes(const Value &value, CompareOp op, const Value &constant) {
+  int cmp = compare_values(value, constant);
+  switch (op) {
+  case CompareOp::Equal:
+    return cmp == 0;
+  case CompareOp::NotEqual:
+    return cmp != 0;
+  case CompareOp::Less:
+    return cmp < 0;
+  case CompareOp::LessEqual:
+    return cmp <= 0;
+  case CompareOp::Greater:
+    return cmp > 0;
+  case CompareOp::GreaterEqual:
+    return cmp >= 0;
+  }
+  return false;
+}
+
+} // namespace
+
+Predicate parse_predicate(const std::string &text, const Schema &schema) {
+  size_t op_start = text.find_first_of("=!<>");
+  if (op_start == std::string::npos) {
+    throw std::runtime_error("Predicate has no comparison: " + text);
+  }
+  size_t op_end = text.find_first_not_of("=!<>", op_start);
+  std::string_view op_text =
+      std::string_view(text).substr(op_start, op_end - op_start);
+
+  Predicate predicate;
+  if (op_text == "=") {
+    predicate.op = CompareOp::Equal;
+  } else if (op_text == "!=") {
+    predicate.op = CompareOp::NotEqual;
+  } else if (op_text == "<") {
+    predicate.op = CompareOp::Less;
+  } else if (op_text == "<=") {
+    predicate.op = CompareOp::LessEqual;
+  } else if (op_text == ">") {
+    predicate.op = CompareOp::Greater;
+  } else if (op_text == ">=") {
+    predicate.op = CompareOp::GreaterEqual;
+  } else {
+    throw std::runtime_error("Unknown comparison in predicate: " + text);
+  }
+
+  predicate.column =
+      std::string(trim(std::string_view(text).substr(0, op_start)));
+  int column = schema.get_column_index(predicate.column);
+  if (column == -1) {
+    throw std::runtime_error("Predicate column not found: " +
+                             predicate.column);
+  }
+  std::string_view value_text =
+      op_end == std::string::npos
+          ? std::string_view()
+          : trim(std::string_view(text).substr(op_end));
+  if (!parse_value(value_text, schema[column], predicate.value)) {
+    throw std::runtime_error("Invalid value in predicate: " + text);
+  }
+  return predicate;
+}
+
+ScanProjection::ScanProjection(const Schema &schema, const ScanSpec &spec,
+                               const std::string &key_column)
+    : input_schema(schema), key_filter(spec.key_filter),
+      keeps_all(spec.columns.empty()) {
+  int key = schema.get_column_index(key_column);
+  if (key == -1) {
+    throw std::runtime_error("Key column not found: " + key_column);
+  }
+  key_index = key;
+
+  for (const Predicate &predicate : spec.predicates) {
+    int index = schema.get_column_index(predicate.column);
+    if (index == -1) {
+      throw std::runtime_error("Predicate column not found: " +
+                               predicate.column);
+    }
+    filters.emplace_back(index, predicate);
+  }
+
+  if (keeps_all) {
+    output_schema = schema;
+    return;
+  }
+  bool has_key = false;
+  for (const std::string &name : spec.columns) {
+    has_key = has_key || name == key_column;
+  }
+  if (!has_key) {
+    kept_columns.push_back(key_index);
+  }
+  std::vector<Column> columns;
+  for (const std::string &name : spec.columns) {
+    int index = schema.get_column_index(name);
+    if (index == -1) {
+      throw std::runtime_error("Projected column not found: " + name);
+    }
+    kept_columns.push_back(index);
+  }
+  for (size_t index : kept_columns) {
+    columns.push_back(schema[index]);
+  }
+  output_schema = Schema(columns);
+}
+
+bool ScanProjection::apply(RowRef row, RowRef &out) {
+  for (const auto &[column, predicate] : filters) {
+    if (!passes(input_schema.column_value(row, column), predicate.op,
+                predicate.value)) {
+      return false;
+    }
+  }
+  if (key_filter &&
+      !key_filter->probe(input_schema.column_value(row, key_index))) {
+    return false;
+  }
+  if (keeps_all) {
+    out = row;
+    return true;
+  }
+
+  input_schema.column_offsets(row, offsets);
+  buffer.clear();
+  for (size_t column : kept_columns) {
+    buffer.append(row.data + offsets[column],
+                  offsets[column + 1] - offsets[column]);
+  }
+  out = {buffer.data(), buffer.size()};
+  return true;
+}
+
+} // namespace JoinOperations
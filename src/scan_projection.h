@@ -0,0 +1,69 @@
+#ifndef SCAN_PROJECTION_H
+#define SCAN_PROJECTION_H
+
+#include "schema.h"
+#include <string>
+#include <vector>
+
+namespace JoinOperations {
+
+class BloomFilter;
+
+enum class CompareOp { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+// column <op> value, for example ano_producao > 2000. The value should have
+// the column's type; compare_values orders any other mix by type.
+struct Predicate {
+  std::string column;
+  CompareOp op;
+  Value value;
+};
+
+// Parses "column op value" with op one of = != < <= > >=, converting the
+// value to the type of the column in schema
+Predicate parse_predicate(const std::string &text, const Schema &schema);
+
+// What a join reads from one input: the columns it needs, in the order
+// listed, and predicates every row must pass. No columns keeps them all.
+// Rows passing the predicates are also dropped when key_filter rules out
+// their key; the filter is not owned and counts its probes.
+struct ScanSpec {
+  std::vector<std::string> columns;
+  std::vector<Predicate> predicates;
+  BloomFilter *key_filter = nullptr;
+
+  bool empty() const {
+    return columns.empty() && predicates.empty() && !key_filter;
+  }
+};
+
+// A ScanSpec resolved against a table's schema. The key column is always
+// kept, first if the list leaves it out, so the projected rows can still be
+// sorted and joined on it.
+class ScanProjection {
+private:
+  const Schema &input_schema;
+  Schema output_schema;
+  std::vector<size_t> kept_columns;
+  std::vector<std::pair<size_t, Predicate>> filters;
+  size_t key_index;
+  BloomFilter *key_filter;
+  bool keeps_all;
+
+  std::vector<size_t> offsets;
+  std::string buffer;
+
+public:
+  ScanProjection(const Schema &schema, const ScanSpec &spec,
+                 const std::string &key_column);
+
+  const Schema &get_schema() const { return output_schema; }
+
+  // False when the row fails a predicate. Otherwise out is set to the row
+  // with only the kept columns, valid until the next call.
+  bool apply(RowRef row, RowRef &out);
+};
+
+} // namespace JoinOperations
+
+#endif // SCAN_PROJECTION_H
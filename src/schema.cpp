@@ -0,0 +1,509 @@
+#include "schema.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant)
+int32_t days_from_civil(int year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                       day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+void civil_from_days(int32_t days, int &year, unsigned &month,
+                     unsigned &day) {
+  days += 719468;
+  const int era = (days >= 0 ? days : days - 146096) / 146097;
+  const unsigned doe = static_cast<unsigned>(days - era * 146097);
+  const unsigned yoe =
+      (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = static_cast<int>(yoe) + era * 400 + (month <= 2);
+}
+
+bool is_leap_year(int year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+unsigned days_in_month(int year, unsigned month) {
+  static const unsigned DAYS[] = {31, 28, 31, 30, 31, 30,
+                                  31, 31, 30, 31, 30, 31};
+  return month == 2 && is_leap_year(year) ? 29 : DAYS[month - 1];
+}
+
+template <typename T> bool parse_number(std::string_view text, T &out) {
+  if (!text.empty() && text.front() == '+') {
+    text.remove_prefix(1);
+  }
+  if (text.empty()) {
+    return false;
+  }
+  const char *end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, out);
+  return ec == std::errc() && ptr == end;
+}
+
+bool parse_int64(std::string_view text, int64_t &out) {
+  return parse_number(text, out);
+}
+
+bool parse_double(std::string_view text, double &out) {
+  return parse_number(text, out) && std::isfinite(out);
+}
+
+// Accepts YYYY-MM-DD
+bool parse_date(std::string_view text, Date &out) {
+  if (text.size() != 10 || text[4] != '-' || text[7] != '-') {
+    return false;
+  }
+  int year = 0;
+  unsigned month = 0, day = 0;
+  auto parse_part = [&text](size_t pos, size_t len, auto &value) {
+    const char *begin = text.data() + pos;
+    auto [ptr, ec] = std::from_chars(begin, begin + len, value);
+    return ec == std::errc() && ptr == begin + len;
+  };
+  if (!parse_part(0, 4, year) || !parse_part(5, 2, month) ||
+      !parse_part(8, 2, day)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+    return false;
+  }
+  out = Date{days_from_civil(year, month, day)};
+  return true;
+}
+
+template <typename T> void put(char *&dst, const T &value) {
+  std::memcpy(dst, &value, sizeof(T));
+  dst += sizeof(T);
+}
+
+template <typename T> T get(const char *&src) {
+  T value;
+  std::memcpy(&value, src, sizeof(T));
+  src += sizeof(T);
+  return value;
+}
+
+// Reuses the string a value already holds
+void assign_text(Value &out, const char *text, size_t length) {
+  if (std::string *held = std::get_if<std::string>(&out)) {
+    held->assign(text, length);
+  } else {
+    out = std::string(text, length);
+  }
+}
+
+// Reads one encoded column at src and moves src past it. The value is only
+// decoded when out is set, so skipping a column never allocates.
+void decode_column(const Column &column, const char *&src, const char *end,
+                   Value *out) {
+  auto require = [&](size_t bytes) {
+    if (static_cast<size_t>(end - src) < bytes) {
+      throw std::runtime_error("Corrupt row: read past end of buffer");
+    }
+  };
+
+  switch (column.type) {
+  case ColumnType::Int64:
+  case ColumnType::Double:
+    require(8);
+    if (!out) {
+      src += 8;
+    } else if (column.type == ColumnType::Int64) {
+      *out = get<int64_t>(src);
+    } else {
+      *out = get<double>(src);
+    }
+    break;
+  case ColumnType::Date:
+    require(4);
+    if (out) {
+      *out = Date{get<int32_t>(src)};
+    } else {
+      src += 4;
+    }
+    break;
+  case ColumnType::FixedString:
+    require(column.length);
+    if (out) {
+      assign_text(*out, src, strnlen(src, column.length));
+    }
+    src += column.length;
+    break;
+  case ColumnType::VarString: {
+    require(sizeof(uint16_t));
+    uint16_t length = get<uint16_t>(src);
+    require(length);
+    if (out) {
+      assign_text(*out, src, length);
+    }
+    src += length;
+    break;
+  }
+  }
+}
+
+} // namespace
+
+Date make_date(int year, unsigned month, unsigned day) {
+  return Date{days_from_civil(year, month, day)};
+}
+
+const char *column_type_name(ColumnType type) {
+  switch (type) {
+  case ColumnType::Int64:
+    return "int64";
+  case ColumnType::Double:
+    return "double";
+  case ColumnType::FixedString:
+    return "char";
+  case ColumnType::VarString:
+    return "varchar";
+  case ColumnType::Date:
+    return "date";
+  }
+  return "unknown";
+}
+
+bool parse_column_type(std::string_view name, ColumnType &type) {
+  for (ColumnType candidate :
+       {ColumnType::Int64, ColumnType::Double, ColumnType::FixedString,
+        ColumnType::VarString, ColumnType::Date}) {
+    if (name == column_type_name(candidate)) {
+      type = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Schema implementation
+Schema::Schema(std::vector<Column> cols) : columns(std::move(cols)) {
+  for (size_t i = 0; i < columns.size(); ++i) {
+    column_names.push_back(columns[i].name);
+    column_index_map[columns[i].name] = i;
+  }
+}
+
+int Schema::get_column_index(const std::string &column_name) const {
+  auto it = column_index_map.find(column_name);
+  if (it != column_index_map.end()) {
+    return static_cast<int>(it->second);
+  }
+  return -1;
+}
+
+bool Schema::operator==(const Schema &other) const {
+  if (columns.size() != other.columns.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const Column &a = columns[i];
+    const Column &b = other.columns[i];
+    if (a.name != b.name || a.type != b.type || a.length != b.length) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t Schema::row_bytes(const Row &row) const {
+  size_t bytes = 0;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    switch (columns[i].type) {
+    case ColumnType::Int64:
+    case ColumnType::Double:
+      bytes += 8;
+      break;
+    case ColumnType::Date:
+      bytes += 4;
+      break;
+    case ColumnType::FixedString:
+      bytes += columns[i].length;
+      break;
+    case ColumnType::VarString:
+      bytes += sizeof(uint16_t) + std::get<std::string>(row[i]).size();
+      break;
+    }
+  }
+  return bytes;
+}
+
+void Schema::serialize_row(const Row &row, char *dst) const {
+  if (row.size() != columns.size()) {
+    throw std::runtime_error("Row has " + std::to_string(row.size()) +
+                             " columns, schema has " +
+                             std::to_string(columns.size()));
+  }
+
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const Column &column = columns[i];
+    switch (column.type) {
+    case ColumnType::Int64:
+      put(dst, std::get<int64_t>(row[i]));
+      break;
+    case ColumnType::Double:
+      put(dst, std::get<double>(row[i]));
+      break;
+    case ColumnType::Date:
+      put(dst, std::get<Date>(row[i]).days);
+      break;
+    case ColumnType::FixedString: {
+      const std::string &text = std::get<std::string>(row[i]);
+      if (text.size() > column.length) {
+        throw std::runtime_error("Value too long for column " + column.name);
+      }
+      std::memcpy(dst, text.data(), text.size());
+      std::memset(dst + text.size(), 0, column.length - text.size());
+      dst += column.length;
+      break;
+    }
+    case ColumnType::VarString: {
+      const std::string &text = std::get<std::string>(row[i]);
+      if (text.size() > UINT16_MAX) {
+        throw std::runtime_error("Value too long for column " + column.name);
+      }
+      put(dst, static_cast<uint16_t>(text.size()));
+      std::memcpy(dst, text.data(), text.size());
+      dst += text.size();
+      break;
+    }
+    }
+  }
+}
+
+size_t
+Schema::text_row_bytes(const std::vector<std::string_view> &fields) const {
+  size_t bytes = 0;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    switch (columns[i].type) {
+    case ColumnType::Int64:
+    case ColumnType::Double:
+      bytes += 8;
+      break;
+    case ColumnType::Date:
+      bytes += 4;
+      break;
+    case ColumnType::FixedString:
+      bytes += columns[i].length;
+      break;
+    case ColumnType::VarString:
+      bytes += sizeof(uint16_t) + fields[i].size();
+      break;
+    }
+  }
+  return bytes;
+}
+
+size_t Schema::encode_text_row(const std::vector<std::string_view> &fields,
+                               char *dst) const {
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const Column &column = columns[i];
+    std::string_view text = fields[i];
+    switch (column.type) {
+    case ColumnType::Int64: {
+      int64_t number;
+      if (!parse_int64(text, number)) {
+        return i;
+      }
+      put(dst, number);
+      break;
+    }
+    case ColumnType::Double: {
+      double number;
+      if (!parse_double(text, number)) {
+        return i;
+      }
+      put(dst, number);
+      break;
+    }
+    case ColumnType::Date: {
+      Date date;
+      if (!parse_date(text, date)) {
+        return i;
+      }
+      put(dst, date.days);
+      break;
+    }
+    case ColumnType::FixedString:
+      if (text.size() > column.length) {
+        return i;
+      }
+      std::memcpy(dst, text.data(), text.size());
+      std::memset(dst + text.size(), 0, column.length - text.size());
+      dst += column.length;
+      break;
+    case ColumnType::VarString:
+      if (text.size() > UINT16_MAX) {
+        return i;
+      }
+      put(dst, static_cast<uint16_t>(text.size()));
+      std::memcpy(dst, text.data(), text.size());
+      dst += text.size();
+      break;
+    }
+  }
+  return columns.size();
+}
+
+size_t Schema::deserialize_row(const char *src, size_t available,
+                               Row &row) const {
+  const char *start = src;
+  const char *end = src + available;
+  row.resize(columns.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    decode_column(columns[i], src, end, &row[i]);
+  }
+  return static_cast<size_t>(src - start);
+}
+
+size_t Schema::encoded_row_size(const char *src, size_t available) const {
+  const char *start = src;
+  const char *end = src + available;
+  for (const Column &column : columns) {
+    decode_column(column, src, end, nullptr);
+  }
+  return static_cast<size_t>(src - start);
+}
+
+Value Schema::column_value(RowRef row, size_t column) const {
+  const char *src = row.data;
+  const char *end = row.data + row.size;
+  for (size_t i = 0; i < column; ++i) {
+    decode_column(columns[i], src, end, nullptr);
+  }
+  Value value;
+  decode_column(columns[column], src, end, &value);
+  return value;
+}
+
+void Schema::column_offsets(RowRef row, std::vector<size_t> &offsets) const {
+  const char *src = row.data;
+  const char *end = row.data + row.size;
+  offsets.resize(columns.size() + 1);
+  for (size_t i = 0; i < columns.size(); ++i) {
+    offsets[i] = static_cast<size_t>(src - row.data);
+    decode_column(columns[i], src, end, nullptr);
+  }
+  offsets[columns.size()] = static_cast<size_t>(src - row.data);
+}
+
+bool parse_value(std::string_view text, const Column &column, Value &value) {
+  switch (column.type) {
+  case ColumnType::Int64: {
+    int64_t number;
+    if (!parse_int64(text, number)) {
+      return false;
+    }
+    value = number;
+    return true;
+  }
+  case ColumnType::Double: {
+    double number;
+    if (!parse_double(text, number)) {
+      return false;
+    }
+    value = number;
+    return true;
+  }
+  case ColumnType::Date: {
+    Date date;
+    if (!parse_date(text, date)) {
+      return false;
+    }
+    value = date;
+    return true;
+  }
+  case ColumnType::FixedString:
+    if (text.size() > column.length) {
+      return false;
+    }
+    value = std::string(text);
+    return true;
+  case ColumnType::VarString:
+    if (text.size() > UINT16_MAX) {
+      return false;
+    }
+    value = std::string(text);
+    return true;
+  }
+  return false;
+}
+
+// ColumnTypeInference implementation
+void ColumnTypeInference::observe(std::string_view text) {
+  int64_t int_value;
+  double double_value;
+  Date date_value;
+
+  if (can_be_int && !parse_int64(text, int_value)) {
+    can_be_int = false;
+  }
+  if (can_be_double && !parse_double(text, double_value)) {
+    can_be_double = false;
+  }
+  if (can_be_date && !parse_date(text, date_value)) {
+    can_be_date = false;
+  }
+  if (observed == 0) {
+    length = text.size();
+  } else if (text.size() != length) {
+    same_length = false;
+  }
+  observed++;
+}
+
+Column ColumnTypeInference::result(const std::string &name) const {
+  if (observed == 0) {
+    return Column(name, ColumnType::VarString);
+  }
+  if (can_be_int) {
+    return Column(name, ColumnType::Int64);
+  }
+  if (can_be_double) {
+    return Column(name, ColumnType::Double);
+  }
+  if (can_be_date) {
+    return Column(name, ColumnType::Date);
+  }
+  if (same_length && length > 0 && length <= MAX_FIXED_LENGTH) {
+    return Column(name, ColumnType::FixedString, length);
+  }
+  return Column(name, ColumnType::VarString);
+}
+
+std::string to_string(const Value &value) {
+  switch (value.index()) {
+  case 0:
+    return std::to_string(std::get<int64_t>(value));
+  case 1: {
+    char buffer[32];
+    auto [ptr, ec] =
+        std::to_chars(buffer, buffer + sizeof(buffer), std::get<double>(value));
+    return std::string(buffer, ptr);
+  }
+  case 2:
+    return std::get<std::string>(value);
+  case 3: {
+    int year;
+    unsigned month, day;
+    civil_from_days(std::get<Date>(value).days, year, month, day);
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, day);
+    return buffer;
+  }
+  }
+  return "";
+}
@@ -0,0 +1,145 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+enum class ColumnType { Int64, Double, FixedString, VarString, Date };
+
+// Calendar date stored as days since 1970-01-01
+struct Date {
+  int32_t days;
+};
+
+// A single field in its native representation. FixedString and VarString
+// columns both hold std::string; they differ only in their on-disk encoding.
+using Value = std::variant<int64_t, double, std::string, Date>;
+
+struct Row {
+  std::vector<Value> columns;
+
+  Row() = default;
+  Row(std::vector<Value> cols) : columns(std::move(cols)) {}
+
+  Value &operator[](size_t index) { return columns[index]; }
+  const Value &operator[](size_t index) const { return columns[index]; }
+
+  size_t size() const { return columns.size(); }
+  void resize(size_t size) { columns.resize(size); }
+};
+
+// A row in a Schema's binary encoding, read in place from a page, a run
+// record or a RowArena. Valid only while the memory it points into is.
+struct RowRef {
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+struct Column {
+  std::string name;
+  ColumnType type;
+  size_t length; // Width in bytes of a FixedString, 0 for other types
+
+  Column(std::string column_name,
+         ColumnType column_type = ColumnType::VarString,
+         size_t fixed_length = 0)
+      : name(std::move(column_name)), type(column_type),
+        length(fixed_length) {}
+};
+
+// Column names and types of a table, plus the binary row encoding used for
+// pages and run files:
+//   Int64, Double   8 bytes
+//   Date            4 bytes (days since epoch)
+//   FixedString(n)  n bytes, zero padded
+//   VarString       u16 length followed by the bytes
+class Schema {
+private:
+  std::vector<Column> columns;
+  std::vector<std::string> column_names;
+  std::unordered_map<std::string, size_t> column_index_map;
+
+public:
+  Schema() = default;
+  Schema(std::vector<Column> cols);
+
+  size_t size() const { return columns.size(); }
+  const Column &operator[](size_t index) const { return columns[index]; }
+  const std::vector<Column> &get_columns() const { return columns; }
+  const std::vector<std::string> &get_column_names() const {
+    return column_names;
+  }
+  int get_column_index(const std::string &column_name) const;
+
+  // Same column names, types and lengths
+  bool operator==(const Schema &other) const;
+  bool operator!=(const Schema &other) const { return !(*this == other); }
+
+  // Serialized size of a row; rows must match the schema
+  size_t row_bytes(const Row &row) const;
+  // Writes a row at dst, which must have row_bytes(row) bytes available
+  void serialize_row(const Row &row, char *dst) const;
+  // Encoded size of a row made of CSV fields, one per column, as if every
+  // field were a valid value of its column
+  size_t text_row_bytes(const std::vector<std::string_view> &fields) const;
+  // Parses each CSV field as its column's type straight into the encoding
+  // at dst, which must have text_row_bytes(fields) bytes available. Returns
+  // the index of the first field that is not a valid value, or size() once
+  // the whole row is written.
+  size_t encode_text_row(const std::vector<std::string_view> &fields,
+                         char *dst) const;
+  // Reads a row from at most `available` bytes; returns the bytes consumed.
+  // Strings are assigned into those the row already holds, so decoding
+  // into the same Row again does not allocate once it has held them.
+  size_t deserialize_row(const char *src, size_t available, Row &row) const;
+  void deserialize_row(RowRef row, Row &out) const {
+    deserialize_row(row.data, row.size, out);
+  }
+  // Size of the encoded row starting at src, reading at most `available`
+  // bytes
+  size_t encoded_row_size(const char *src, size_t available) const;
+  // Decodes a single column of an encoded row
+  Value column_value(RowRef row, size_t column) const;
+  // Where each column of an encoded row starts: offsets[i] for column i,
+  // and offsets[size()] where the row ends. The columns need no separators,
+  // so any subset of them copied in order is a valid row of that subset.
+  void column_offsets(RowRef row, std::vector<size_t> &offsets) const;
+};
+
+const char *column_type_name(ColumnType type);
+// Inverse of column_type_name; returns false for an unknown name
+bool parse_column_type(std::string_view name, ColumnType &type);
+
+// Converts CSV text to a value of the column's type. Returns false when the
+// text is not a valid value of that type.
+bool parse_value(std::string_view text, const Column &column, Value &value);
+
+// Infers a column type from the values seen in a CSV column. The result is
+// the narrowest type that accepts every value: Int64, then Double, then
+// Date, then FixedString when all values share a short length, and
+// VarString otherwise.
+class ColumnTypeInference {
+private:
+  static const size_t MAX_FIXED_LENGTH = 16;
+
+  bool can_be_int = true;
+  bool can_be_double = true;
+  bool can_be_date = true;
+  bool same_length = true;
+  size_t length = 0;
+  size_t observed = 0;
+
+public:
+  void observe(std::string_view text);
+  Column result(const std::string &name) const;
+};
+
+std::string to_string(const Value &value);
+
+Date make_date(int year, unsigned month, unsigned day);
+
+#endif // SCHEMA_H
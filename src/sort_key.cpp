@@ -0,0 +1,85 @@
+#include "sort_key.h"
+#include <algorithm>
+#include <cstring>
+
+namespace SortKey {
+
+namespace {
+
+void append_big_endian(uint64_t value, size_t bytes, std::string &key) {
+  for (size_t i = bytes; i > 0; --i) {
+    key.push_back(static_cast<char>((value >> ((i - 1) * 8)) & 0xff));
+  }
+}
+
+} // namespace
+
+void append(const Value &value, std::string &key) {
+  switch (value.index()) {
+  case 0: {
+    uint64_t bits = static_cast<uint64_t>(std::get<int64_t>(value));
+    append_big_endian(bits ^ (1ULL << 63), 8, key);
+    break;
+  }
+  case 1: {
+    double number = std::get<double>(value);
+    if (number == 0.0) {
+      number = 0.0; // -0.0 and 0.0 compare equal
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    bits = (bits & (1ULL << 63)) ? ~bits : bits | (1ULL << 63);
+    append_big_endian(bits, 8, key);
+    break;
+  }
+  case 2: {
+    const std::string &text = std::get<std::string>(value);
+    for (char c : text) {
+      key.push_back(c);
+      if (c == '\0') {
+        key.push_back('\xff');
+      }
+    }
+    key.push_back('\0');
+    key.push_back('\0');
+    break;
+  }
+  case 3: {
+    uint32_t bits = static_cast<uint32_t>(std::get<Date>(value).days);
+    append_big_endian(bits ^ (1U << 31), 4, key);
+    break;
+  }
+  }
+}
+
+std::string encode(const Value &value) {
+  std::string key;
+  append(value, key);
+  return key;
+}
+
+uint64_t prefix(const std::string &key) {
+  uint64_t head = 0;
+  size_t bytes = std::min<size_t>(key.size(), 8);
+  for (size_t i = 0; i < 8; ++i) {
+    head <<= 8;
+    if (i < bytes) {
+      head |= static_cast<unsigned char>(key[i]);
+    }
+  }
+  return head;
+}
+
+int compare(const std::string &a, const std::string &b) {
+  size_t common = std::min(a.size(), b.size());
+  int cmp = common == 0 ? 0 : std::memcmp(a.data(), b.data(), common);
+  if (cmp != 0) {
+    return cmp < 0 ? -1 : 1;
+  }
+  if (a.size() == b.size()) {
+    return 0;
+  }
+  return a.size() < b.size() ? -1 : 1;
+}
+
+} // namespace SortKey
@@ -0,0 +1,47 @@
+#ifndef SORT_KEY_H
+#define SORT_KEY_H
+
+#include "schema.h"
+#include <cstdint>
+#include <string>
+
+// Normalized sort keys: a binary encoding of values whose memcmp order is the
+// order of the values themselves, so sorting and merging compare bytes only.
+//   Int64   8 bytes big-endian with the sign bit flipped
+//   Double  8 bytes big-endian; positives get the sign bit set, negatives
+//           have every bit inverted
+//   Date    4 bytes big-endian with the sign bit flipped
+//   String  bytes with 0x00 escaped as 0x00 0xFF, terminated by 0x00 0x00
+// Keys of values of the same column type compare like compare_values.
+namespace SortKey {
+
+void append(const Value &value, std::string &key);
+std::string encode(const Value &value);
+
+// First 8 key bytes as a big-endian integer, zero padded. Keys with
+// different prefixes are ordered by the prefix alone.
+uint64_t prefix(const std::string &key);
+
+int compare(const std::string &a, const std::string &b);
+
+// Key plus its cached prefix, so most comparisons are one integer compare
+struct Normalized {
+  uint64_t head = 0;
+  std::string bytes;
+
+  Normalized() = default;
+  explicit Normalized(std::string key)
+      : head(prefix(key)), bytes(std::move(key)) {}
+
+  bool operator<(const Normalized &other) const {
+    if (head != other.head) {
+      return head < other.head;
+    }
+    return compare(bytes, other.bytes) < 0;
+  }
+  bool operator>(const Normalized &other) const { return other < *this; }
+};
+
+} // namespace SortKey
+
+#endif // SORT_KEY_H
@@ -0,0 +1,97 @@
+#include "sorted_table_cache.h"
+#include "buffer_manager.h"
+#include "table.h"
+
+namespace JoinOperations {
+
+SortedTableCache::SortedTableCache(std::shared_ptr<BufferManager> bm,
+                                   size_t budget)
+    : buffer_manager(std::move(bm)), budget_bytes(budget), used_bytes(0),
+      hit_count(0), miss_count(0) {}
+
+void SortedTableCache::erase(std::list<Entry>::iterator it, bool drop_table) {
+  used_bytes -= it->bytes;
+  if (drop_table) {
+    it->sorted->drop();
+  }
+  entries.erase(it);
+}
+
+void SortedTableCache::drop_stale() {
+  for (auto it = entries.begin(); it != entries.end();) {
+    auto next = std::next(it);
+    if (buffer_manager->get_table_version(it->table_id) != it->version) {
+      erase(it, true);
+    }
+    it = next;
+  }
+}
+
+void SortedTableCache::evict_to(size_t bytes) {
+  // Oldest entries first; copies a caller still holds stay
+  for (auto it = entries.end(); used_bytes > bytes && it != entries.begin();) {
+    --it;
+    if (it->sorted.use_count() > 1) {
+      continue;
+    }
+    auto victim = it++;
+    erase(victim, true);
+  }
+}
+
+std::shared_ptr<Table> SortedTableCache::find(const Table &table,
+                                              const std::string &column) {
+  std::lock_guard<std::mutex> lock(mutex);
+  drop_stale();
+
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->table_name == table.get_name() && it->column == column) {
+      entries.splice(entries.begin(), entries, it);
+      hit_count++;
+      return it->sorted;
+    }
+  }
+  miss_count++;
+  return nullptr;
+}
+
+bool SortedTableCache::contains(const Table &table,
+                                const std::string &column) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const Entry &entry : entries) {
+    if (entry.table_name == table.get_name() && entry.column == column) {
+      return buffer_manager->get_table_version(entry.table_id) ==
+             entry.version;
+    }
+  }
+  return false;
+}
+
+void SortedTableCache::insert(const Table &table, const std::string &column,
+                              std::shared_ptr<Table> sorted) {
+  std::lock_guard<std::mutex> lock(mutex);
+  drop_stale();
+
+  // An older copy on the same key lives in the same file as the new one
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->table_name == table.get_name() && it->column == column) {
+      erase(it, false);
+      break;
+    }
+  }
+
+  size_t bytes = static_cast<size_t>(sorted->get_total_pages()) *
+                 buffer_manager->get_page_size();
+  if (bytes > budget_bytes) {
+    return;
+  }
+  evict_to(budget_bytes - bytes);
+
+  uint32_t table_id = table.get_table_id();
+  entries.push_front(Entry{table.get_name(), column, table_id,
+                           buffer_manager->get_table_version(table_id),
+                           std::move(sorted), bytes});
+  used_bytes += bytes;
+}
+
+} // namespace JoinOperations
@@ -0,0 +1,78 @@
+#ifndef SORTED_TABLE_CACHE_H
+#define SORTED_TABLE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class BufferManager;
+class Table;
+
+namespace JoinOperations {
+
+// Sorted copies of tables made by external_sort, keyed by source table, sort
+// column and the source's version in the buffer manager. A join that needs
+// a table sorted on a key it was already sorted on reuses the copy instead
+// of sorting again. Writing to the source changes its version, as do
+// Table::truncate and Table::drop, which makes its entries stale; they are
+// dropped on the next lookup or insert. When the copies exceed the disk
+// budget the least recently used ones are dropped, except those a caller
+// still holds.
+class SortedTableCache {
+private:
+  struct Entry {
+    std::string table_name;
+    std::string column;
+    uint32_t table_id;
+    uint64_t version;
+    std::shared_ptr<Table> sorted;
+    size_t bytes;
+  };
+
+  std::shared_ptr<BufferManager> buffer_manager;
+  size_t budget_bytes;
+  size_t used_bytes;
+  std::list<Entry> entries; // Most recently used first
+  size_t hit_count;
+  size_t miss_count;
+  mutable std::mutex mutex;
+
+  void erase(std::list<Entry>::iterator it, bool drop_table);
+  void drop_stale();
+  void evict_to(size_t bytes);
+
+public:
+  SortedTableCache(std::shared_ptr<BufferManager> bm, size_t budget);
+
+  SortedTableCache(const SortedTableCache &) = delete;
+  SortedTableCache &operator=(const SortedTableCache &) = delete;
+
+  // The cached copy of `table` sorted on `column`, or nullptr
+  std::shared_ptr<Table> find(const Table &table, const std::string &column);
+  // Whether find() would return a copy; does not count as a use
+  bool contains(const Table &table, const std::string &column) const;
+  // Caches `sorted` as the current sort of `table` on `column`. Copies
+  // larger than the whole budget are not kept.
+  void insert(const Table &table, const std::string &column,
+              std::shared_ptr<Table> sorted);
+
+  size_t get_budget_bytes() const { return budget_bytes; }
+  size_t get_used_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used_bytes;
+  }
+  size_t get_hit_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+  }
+  size_t get_miss_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+  }
+};
+
+} // namespace JoinOperations
+
+#endif // SORTED_TABLE_CACHE_H
@@ -0,0 +1,31 @@
+#include "spill_table.h"
+#include "table.h"
+
+namespace JoinOperations {
+
+SpillTable::SpillTable(const std::string &name, const Schema &schema,
+                       std::shared_ptr<BufferManager> buffer_manager)
+    : table(std::make_shared<Table>(name, schema, buffer_manager)),
+      page_id(0) {
+  table->truncate();
+  page = table->new_page(page_id);
+}
+
+void SpillTable::add(RowRef row) {
+  if (!page->can_fit(row) && !page->rows.empty()) {
+    table->write_page(page);
+    page = table->new_page(++page_id);
+  }
+  page->add_row(row);
+}
+
+std::shared_ptr<Table> SpillTable::finish() {
+  if (!page->rows.empty()) {
+    table->write_page(page);
+    ++page_id;
+  }
+  table->set_total_pages(page_id);
+  return table;
+}
+
+} // namespace JoinOperations
@@ -0,0 +1,35 @@
+#ifndef SPILL_TABLE_H
+#define SPILL_TABLE_H
+
+#include "schema.h"
+#include <memory>
+#include <string>
+
+class BufferManager;
+class Page;
+class Table;
+
+namespace JoinOperations {
+
+// Rows an operator cannot keep in memory, packed into the pages of a
+// temporary table as they arrive. Pages go through the buffer pool, so they
+// only reach disk when the pool needs the room. The caller drops the table
+// when done with it.
+class SpillTable {
+private:
+  std::shared_ptr<Table> table;
+  std::shared_ptr<Page> page;
+  int page_id;
+
+public:
+  SpillTable(const std::string &name, const Schema &schema,
+             std::shared_ptr<BufferManager> buffer_manager);
+
+  void add(RowRef row);
+  // Writes the last page and returns the table, ready to scan
+  std::shared_ptr<Table> finish();
+};
+
+} // namespace JoinOperations
+
+#endif // SPILL_TABLE_H
@@ -1,157 +1,262 @@
 #include "table.h"
 #include "buffer_manager.h"
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include "join_operation.h"
+#include <algorithm>
+#include <stdexcept>
 
 // Page implementation
-void Page::add_row(const Row &row) {
-  if (!is_full()) {
-    rows.push_back(row);
-    dirty = true;
+bool Page::add_row(const Row &row) {
+  size_t bytes = row_bytes(row);
+  if (rows.size() >= MAX_ROWS || used_bytes + bytes > capacity) {
+    if (rows.empty()) {
+      throw std::runtime_error("Row of " + std::to_string(bytes) +
+                               " bytes does not fit in a " +
+                               std::to_string(capacity) + " byte page");
+    }
+    return false;
+  }
+
+  used_bytes += bytes;
+  rows.append(*schema, row);
+  dirty = true;
+  return true;
+}
+
+bool Page::add_row(RowRef row) {
+  if (!can_fit(row)) {
+    if (rows.empty()) {
+      throw std::runtime_error("Row of " + std::to_string(row.size) +
+                               " bytes does not fit in a " +
+                               std::to_string(capacity) + " byte page");
+    }
+    return false;
   }
+
+  used_bytes += row.size;
+  rows.append(row);
+  dirty = true;
+  return true;
+}
+
+Row Page::get_row(size_t index) const {
+  Row row;
+  schema->deserialize_row(rows[index], row);
+  return row;
 }
 
 void Page::clear() {
   rows.clear();
+  used_bytes = HEADER_BYTES;
   dirty = false;
 }
 
 // Table implementation
-Table::Table(const std::string &name, const std::vector<std::string> &columns,
+Table::Table(const std::string &name, const Schema &table_schema,
              std::shared_ptr<BufferManager> bm)
-    : table_name(name), column_names(columns), buffer_manager(bm),
-      total_pages(0) {
-
-  // Build column index map
-  for (size_t i = 0; i < column_names.size(); ++i) {
-    column_index_map[column_names[i]] = i;
-  }
-}
-
-// void Table::load_from_csv(const std::string &filename) {
-//   std::ifstream file(filename);
-//   if (!file.is_open()) {
-//     throw std::runtime_error("Cannot open file: " + filename);
-//   }
-//
-//   std::string line;
-//   bool first_line = true;
-//   int current_page_id = 0;
-//   auto current_page = std::make_shared<Page>(current_page_id);
-//
-//   while (std::getline(file, line)) {
-//     if (first_line) {
-//       first_line = false;
-//       continue; // Skip header line
-//     }
-//
-//     // Parse CSV line
-//     std::vector<std::string> tokens;
-//     std::stringstream ss(line);
-//     std::string token;
-//
-//     while (std::getline(ss, token, ',')) {
-//       // Trim whitespace
-//       token.erase(0, token.find_first_not_of(" \t\r\n"));
-//       token.erase(token.find_last_not_of(" \t\r\n") + 1);
-//       tokens.push_back(token);
-//     }
-//
-//     if (tokens.size() != column_names.size()) {
-//       std::cerr << "Warning: Row has " << tokens.size() << " columns,
-//       expected "
-//                 << column_names.size() << std::endl;
-//       continue;
-//     }
-//
-//     Row row(tokens);
-//
-//     if (current_page->is_full()) {
-//       // Write current page and create new one
-//       write_page(current_page);
-//       current_page_id++;
-//       current_page = std::make_shared<Page>(current_page_id);
-//     }
-//
-//     current_page->add_row(row);
-//   }
-//
-//   // Write the last page if it has data
-//   if (!current_page->rows.empty()) {
-//     write_page(current_page);
-//     current_page_id++;
-//   }
-//
-//   total_pages = current_page_id;
-//   file.close();
-// }
-
-int Table::get_column_index(const std::string &column_name) const {
-  auto it = column_index_map.find(column_name);
-  if (it != column_index_map.end()) {
-    return static_cast<int>(it->second);
-  }
-  return -1;
+    : table_name(name), schema(std::make_shared<const Schema>(table_schema)),
+      buffer_manager(bm), table_id(bm->register_table(name, schema)),
+      total_pages(0) {}
+
+std::shared_ptr<Page> Table::new_page(int page_id) const {
+  return std::make_shared<Page>(page_id, schema,
+                                buffer_manager->get_page_size());
 }
 
 std::shared_ptr<Page> Table::get_page(int page_id) {
-  return buffer_manager->get_page(table_name, page_id);
+  return buffer_manager->get_page(table_id, page_id);
 }
 
 void Table::write_page(std::shared_ptr<Page> page) {
-  buffer_manager->write_page(table_name, page);
+  zones.record(*schema, *page);
+  buffer_manager->write_page(table_id, page);
+}
+
+void Table::truncate() {
+  buffer_manager->create_table(table_id);
+  total_pages = 0;
+  sort_column.clear();
+  stats.reset();
+  zones.clear();
+}
+
+void Table::drop() {
+  buffer_manager->drop_table(table_id);
+  total_pages = 0;
+  sort_column.clear();
+  stats.reset();
+  zones.clear();
+}
+
+void Table::track_zones(const std::string &column) {
+  int index = get_column_index(column);
+  if (index == -1) {
+    throw std::runtime_error("Zone map column not found: " + column);
+  }
+  zones.track(index);
 }
 
 // Iterator implementation
-Table::Iterator::Iterator(Table *t, int page, size_t row)
+Table::Iterator::Iterator(Table *t, int page, size_t row, AccessHint hint)
     : table(t), current_page(page), current_row(row),
-      current_page_ptr(nullptr) {
-  if (current_page < table->get_total_pages()) {
-    current_page_ptr = table->get_page(current_page);
-  }
+      current_page_ptr(nullptr), access_hint(hint), readahead_window(1),
+      readahead_until(page), range_column(-1), skipped_pages(0) {
+  load_page();
 }
 
-bool Table::Iterator::has_next() {
-  if (current_page >= table->get_total_pages()) {
-    return false;
-  }
+Table::Iterator::Iterator(const Iterator &other)
+    : table(other.table), current_page(other.current_page),
+      current_row(other.current_row), current_page_ptr(nullptr),
+      access_hint(other.access_hint), readahead_window(other.readahead_window),
+      readahead_until(other.readahead_until),
+      range_column(other.range_column), range_lower(other.range_lower),
+      range_upper(other.range_upper), skipped_pages(other.skipped_pages) {
+  load_page();
+}
 
-  if (!current_page_ptr) {
-    current_page_ptr = table->get_page(current_page);
+Table::Iterator &Table::Iterator::operator=(const Iterator &other) {
+  if (this != &other) {
+    release_page();
+    table = other.table;
+    current_page = other.current_page;
+    current_row = other.current_row;
+    access_hint = other.access_hint;
+    readahead_window = other.readahead_window;
+    readahead_until = other.readahead_until;
+    range_column = other.range_column;
+    range_lower = other.range_lower;
+    range_upper = other.range_upper;
+    skipped_pages = other.skipped_pages;
+    load_page();
   }
+  return *this;
+}
+
+Table::Iterator::~Iterator() { release_page(); }
 
-  return current_row < current_page_ptr->rows.size();
+void Table::Iterator::load_page() {
+  if (!current_page_ptr && current_page < table->get_total_pages()) {
+    current_page_ptr = table->buffer_manager->pin_page(
+        table->table_id, current_page, access_hint);
+    schedule_readahead();
+  }
 }
 
-Row Table::Iterator::next() {
-  if (!has_next()) {
-    throw std::runtime_error("No more rows");
+void Table::Iterator::schedule_readahead() {
+  if (access_hint != AccessHint::Sequential) {
+    return;
   }
 
-  Row result = current_page_ptr->rows[current_row];
-  current_row++;
+  size_t max_window = table->buffer_manager->get_readahead_pages();
+  if (max_window == 0) {
+    return;
+  }
+  readahead_window = std::min(readahead_window, max_window);
 
-  // Check if we need to move to next page
-  if (current_row >= current_page_ptr->rows.size()) {
-    current_page++;
-    current_row = 0;
+  int last = std::min(table->get_total_pages() - 1,
+                      current_page + static_cast<int>(readahead_window));
+  int first = std::max(readahead_until + 1, current_page + 1);
+  if (first <= last) {
+    table->buffer_manager->prefetch(table->table_id, first, last - first + 1);
+    readahead_until = last;
+  }
+}
+
+void Table::Iterator::release_page() {
+  if (current_page_ptr) {
+    table->buffer_manager->unpin_page(table->table_id,
+                                      current_page_ptr->page_id);
     current_page_ptr = nullptr;
+  }
+}
 
-    if (current_page < table->get_total_pages()) {
-      current_page_ptr = table->get_page(current_page);
+bool Table::Iterator::has_next() {
+  // Moving to the next page waits until here, so a RowRef from the last row
+  // of a page stays valid until the iterator is used again
+  while (current_page < table->get_total_pages()) {
+    if (!current_page_ptr && outside_range(current_page)) {
+      current_page++;
+      current_row = 0;
+      skipped_pages++;
+      continue;
+    }
+    load_page();
+    if (current_row < current_page_ptr->rows.size()) {
+      return true;
     }
+    release_page();
+    current_page++;
+    current_row = 0;
+    // Sequential progress widens the read-ahead window
+    readahead_window *= 2;
   }
+  return false;
+}
 
-  return result;
+Row Table::Iterator::next() {
+  Row row;
+  table->get_schema().deserialize_row(next_ref(), row);
+  return row;
+}
+
+RowRef Table::Iterator::next_ref() {
+  if (!has_next()) {
+    throw std::runtime_error("No more rows");
+  }
+  return current_page_ptr->rows[current_row++];
 }
 
 void Table::Iterator::reset() {
+  release_page();
   current_page = 0;
   current_row = 0;
-  current_page_ptr = nullptr;
+  readahead_window = 1;
+  readahead_until = 0;
+  load_page();
+}
+
+bool Table::Iterator::outside_range(int page) const {
+  const PageZone *zone = table->get_zone(range_column, page);
+  if (!zone) {
+    return false;
+  }
+  if (!zone->has_rows) {
+    return true;
+  }
+  return (range_lower && JoinOperations::compare_values(zone->max_value,
+                                                        *range_lower) < 0) ||
+         (range_upper &&
+          JoinOperations::compare_values(zone->min_value, *range_upper) > 0);
+}
 
-  if (current_page < table->get_total_pages()) {
-    current_page_ptr = table->get_page(current_page);
+void Table::Iterator::set_key_range(int column, const Value *lower,
+                                    const Value *upper) {
+  range_column = column;
+  range_lower = lower ? std::optional<Value>(*lower) : std::nullopt;
+  range_upper = upper ? std::optional<Value>(*upper) : std::nullopt;
+  // The constructor pinned the first page before the range was known
+  if (current_page_ptr && current_row == 0 && outside_range(current_page)) {
+    release_page();
+  }
+}
+
+void Table::Iterator::skip_below(int column, const Value &key) {
+  bool skipped = false;
+  while (current_page < table->get_total_pages()) {
+    const PageZone *zone = table->get_zone(column, current_page);
+    if (!zone || (zone->has_rows &&
+                  JoinOperations::compare_values(zone->max_value, key) >= 0)) {
+      break;
+    }
+    if (!current_page_ptr) {
+      skipped_pages++;
+    }
+    release_page();
+    current_page++;
+    current_row = 0;
+    skipped = true;
+  }
+  if (skipped) {
+    // A jump is not sequential progress; read-ahead starts over from here
+    readahead_window = 1;
   }
 }
@@ -1,82 +1,173 @@
 #ifndef TABLE_H
 #define TABLE_H
+#include "replacement_policy.h"
+#include "row_arena.h"
+#include "schema.h"
+#include "zone_map.h"
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 class BufferManager;
+struct TableStats;
 
-struct Row {
-  std::vector<std::string> columns;
-
-  Row() = default;
-  Row(const std::vector<std::string> &cols) : columns(cols) {}
-
-  std::string &operator[](size_t index) { return columns[index]; }
-  const std::string &operator[](size_t index) const { return columns[index]; }
-
-  size_t size() const { return columns.size(); }
-  void resize(size_t size) { columns.resize(size); }
-};
-
+// Page capacity is measured in serialized bytes, matching the slot size used
+// by the DiskManager: a u16 row count followed by the rows, each encoded as
+// described by the table's Schema. Rows are kept in that encoding in memory
+// too, so reading or writing a page copies bytes instead of building Rows.
 struct Page {
-  static const size_t MAX_ROWS = 10;
-  std::vector<Row> rows;
+  static const size_t HEADER_BYTES = sizeof(uint16_t);
+  static const size_t DEFAULT_CAPACITY = 4096;
+  // The row count is stored in the u16 header, so a large page of small
+  // rows fills up by count before bytes
+  static const size_t MAX_ROWS = UINT16_MAX;
+
+  RowArena rows;
+  std::shared_ptr<const Schema> schema;
   int page_id;
   bool dirty;
+  size_t capacity;
+  size_t used_bytes;
+
+  Page(int id, std::shared_ptr<const Schema> page_schema,
+       size_t capacity_bytes = DEFAULT_CAPACITY)
+      : schema(std::move(page_schema)), page_id(id), dirty(false),
+        capacity(capacity_bytes), used_bytes(HEADER_BYTES) {
+    rows.reserve(capacity_bytes, 0);
+  }
 
-  Page(int id = -1) : page_id(id), dirty(false) {}
+  size_t row_bytes(const Row &row) const { return schema->row_bytes(row); }
 
-  bool is_full() const { return rows.size() >= MAX_ROWS; }
-  void add_row(const Row &row);
+  bool can_fit(const Row &row) const {
+    return rows.size() < MAX_ROWS && used_bytes + row_bytes(row) <= capacity;
+  }
+  bool can_fit(RowRef row) const {
+    return rows.size() < MAX_ROWS && used_bytes + row.size <= capacity;
+  }
+  bool is_full() const {
+    return rows.size() >= MAX_ROWS || used_bytes >= capacity;
+  }
+  bool add_row(const Row &row);
+  bool add_row(RowRef row);
+  // Decoded copy of a row
+  Row get_row(size_t index) const;
   void clear();
 };
 
 class Table {
 private:
   std::string table_name;
-  std::vector<std::string> column_names;
-  std::unordered_map<std::string, size_t> column_index_map;
+  std::shared_ptr<const Schema> schema;
   std::shared_ptr<BufferManager> buffer_manager;
+  uint32_t table_id; // Id assigned by the buffer manager
   int total_pages;
+  std::string sort_column; // Column the rows are ordered on, if any
+  std::shared_ptr<const TableStats> stats;
+  ZoneMap zones;
 
 public:
-  Table(const std::string &name, const std::vector<std::string> &columns,
+  Table(const std::string &name, const Schema &table_schema,
         std::shared_ptr<BufferManager> bm);
 
-  // void load_from_csv(const std::string &filename);
-
-  size_t get_column_count() const { return column_names.size(); }
+  size_t get_column_count() const { return schema->size(); }
+  const Schema &get_schema() const { return *schema; }
   const std::vector<std::string> &get_column_names() const {
-    return column_names;
+    return schema->get_column_names();
+  }
+  int get_column_index(const std::string &column_name) const {
+    return schema->get_column_index(column_name);
   }
-  int get_column_index(const std::string &column_name) const;
 
+  std::shared_ptr<Page> new_page(int page_id) const;
   std::shared_ptr<Page> get_page(int page_id);
+  // Also records the page's zones
   void write_page(std::shared_ptr<Page> page);
+  void truncate();
+  // Deletes the table's pages and file; the table is empty afterwards
+  void drop();
   int get_total_pages() const { return total_pages; }
 
   const std::string &get_name() const { return table_name; }
+  uint32_t get_table_id() const { return table_id; }
   void set_total_pages(int pages) { total_pages = pages; }
 
-  // Iterator support for join operations
+  // Physical order and statistics, filled in by whoever writes the table.
+  // An empty sort column means no known order; stats may be null.
+  const std::string &get_sort_column() const { return sort_column; }
+  void set_sort_column(std::string column) { sort_column = std::move(column); }
+  const TableStats *get_stats() const { return stats.get(); }
+  std::shared_ptr<const TableStats> share_stats() const { return stats; }
+  void set_stats(std::shared_ptr<const TableStats> table_stats) {
+    stats = std::move(table_stats);
+  }
+
+  // Keeps per-page min/max of a column for the pages written from now on
+  void track_zones(const std::string &column);
+  bool has_zones(int column) const {
+    return column >= 0 && zones.tracks(column);
+  }
+  // Null when the column has no zones or the page was not recorded
+  const PageZone *get_zone(int column, int page_id) const {
+    return column >= 0 ? zones.find(column, page_id) : nullptr;
+  }
+
+  // Iterator support for join operations. The iterator keeps its current
+  // page pinned in the buffer pool so it cannot be evicted while in use.
+  // Sequential iterators also read ahead: the window starts at one page and
+  // doubles at every page boundary, up to the buffer manager's limit.
   class Iterator {
   private:
     Table *table;
     int current_page;
     size_t current_row;
     std::shared_ptr<Page> current_page_ptr;
+    AccessHint access_hint;
+    size_t readahead_window;
+    int readahead_until; // Last page already requested
+    // Key range set by set_key_range; column -1 when there is none
+    int range_column;
+    std::optional<Value> range_lower;
+    std::optional<Value> range_upper;
+    size_t skipped_pages;
+
+    void load_page();
+    void release_page();
+    void schedule_readahead();
+    bool outside_range(int page) const;
 
   public:
-    Iterator(Table *t, int page = 0, size_t row = 0);
+    Iterator(Table *t, int page = 0, size_t row = 0,
+             AccessHint hint = AccessHint::Normal);
+    Iterator(const Iterator &other);
+    Iterator &operator=(const Iterator &other);
+    ~Iterator();
 
     bool has_next();
     Row next();
+    // The next row in place, without decoding it. The reference stays valid
+    // until the iterator is used again.
+    RowRef next_ref();
     void reset();
+
+    // Restricts the scan to pages whose zone of column may hold a value in
+    // [lower, upper]; a null bound is open. Pages without a zone are read,
+    // and rows of a page that is read are returned whatever their value.
+    void set_key_range(int column, const Value *lower, const Value *upper);
+    // For a table ordered on column: moves past the rest of the current page
+    // and the pages after it whose zone lies wholly below key, without
+    // reading them. Rows returned earlier are no longer valid.
+    void skip_below(int column, const Value &key);
+    // Pages passed over by set_key_range and skip_below
+    size_t get_skipped_pages() const { return skipped_pages; }
   };
 
-  Iterator get_iterator() { return Iterator(this); }
+  // Scans that read each page once should pass AccessHint::Sequential so
+  // their pages do not displace pages that are reused
+  Iterator get_iterator(AccessHint hint = AccessHint::Normal) {
+    return Iterator(this, 0, 0, hint);
+  }
 };
 
 #endif
@@ -0,0 +1,99 @@
+#include "table_stats.h"
+#include "join_operation.h"
+#include <utility>
+
+StatsCollector::StatsCollector(const Schema &table_schema)
+    : schema(table_schema), distinct(table_schema.size()),
+      ascending(table_schema.size(), true) {
+  stats.columns.resize(table_schema.size());
+}
+
+void StatsCollector::observe(RowRef encoded) {
+  schema.deserialize_row(encoded, current);
+  const Row &row = current;
+  for (size_t i = 0; i < stats.columns.size(); ++i) {
+    ColumnStats &column = stats.columns[i];
+    const Value &value = row[i];
+
+    distinct[i].add(value);
+    if (!column.has_range) {
+      column.min_value = value;
+      column.max_value = value;
+      column.has_range = true;
+    } else {
+      if (JoinOperations::compare_values(value, column.min_value) < 0) {
+        column.min_value = value;
+      }
+      if (JoinOperations::compare_values(value, column.max_value) > 0) {
+        column.max_value = value;
+      }
+    }
+
+    if (stats.row_count > 0 && ascending[i] &&
+        JoinOperations::compare_values(value, last_row[i]) < 0) {
+      ascending[i] = false;
+    }
+  }
+  if (stats.row_count == 0) {
+    first_row = row;
+  }
+  std::swap(last_row, current);
+  stats.row_count++;
+  stats.row_bytes += encoded.size;
+}
+
+void StatsCollector::merge(StatsCollector &&later) {
+  if (later.stats.row_count == 0) {
+    return;
+  }
+  if (stats.row_count == 0) {
+    stats = std::move(later.stats);
+    distinct = std::move(later.distinct);
+    ascending = std::move(later.ascending);
+    first_row = std::move(later.first_row);
+    last_row = std::move(later.last_row);
+    return;
+  }
+
+  for (size_t i = 0; i < stats.columns.size(); ++i) {
+    ColumnStats &column = stats.columns[i];
+    const ColumnStats &other = later.stats.columns[i];
+
+    distinct[i].merge(later.distinct[i]);
+    if (JoinOperations::compare_values(other.min_value, column.min_value) <
+        0) {
+      column.min_value = other.min_value;
+    }
+    if (JoinOperations::compare_values(other.max_value, column.max_value) >
+        0) {
+      column.max_value = other.max_value;
+    }
+    // Both parts must be ascending, and so must the rows where they meet
+    ascending[i] =
+        ascending[i] && later.ascending[i] &&
+        JoinOperations::compare_values(later.first_row[i], last_row[i]) >= 0;
+  }
+  last_row = std::move(later.last_row);
+  stats.row_count += later.stats.row_count;
+  stats.row_bytes += later.stats.row_bytes;
+}
+
+TableStats StatsCollector::result() const {
+  TableStats result = stats;
+  for (size_t i = 0; i < result.columns.size(); ++i) {
+    result.columns[i].distinct_count = distinct[i].estimate();
+  }
+  return result;
+}
+
+std::string StatsCollector::sort_column() const {
+  if (stats.row_count == 0) {
+    return "";
+  }
+  for (size_t i = 0; i < ascending.size(); ++i) {
+    if (ascending[i]) {
+      return schema[i].name;
+    }
+  }
+  return "";
+}
@@ -0,0 +1,52 @@
+#ifndef TABLE_STATS_H
+#define TABLE_STATS_H
+
+#include "distinct_sketch.h"
+#include "schema.h"
+#include <string>
+#include <vector>
+
+struct ColumnStats {
+  size_t distinct_count = 0;
+  bool has_range = false; // False until a value is seen
+  Value min_value;
+  Value max_value;
+};
+
+struct TableStats {
+  size_t row_count = 0;
+  size_t row_bytes = 0; // Serialized size of all rows
+  std::vector<ColumnStats> columns;
+};
+
+// Gathers TableStats from the rows of a table as they are written. Distinct
+// counts come from a DistinctSketch per column, exact for small columns and
+// estimated past DistinctSketch::K values, so memory does not grow with the
+// table. It also notes which columns never decrease, i.e. what the table is
+// already sorted on.
+class StatsCollector {
+private:
+  const Schema &schema;
+  TableStats stats;
+  std::vector<DistinctSketch> distinct;
+  std::vector<bool> ascending;
+  Row first_row;
+  Row last_row;
+  Row current; // Decoded row being observed; swapped with last_row
+
+public:
+  explicit StatsCollector(const Schema &table_schema);
+
+  // Decodes the row into buffers reused from row to row, so observing does
+  // not allocate once they have held the longest strings
+  void observe(RowRef encoded);
+  // Adds the statistics of a collector that saw the rows following this
+  // one's, as when parts of a file are read in parallel
+  void merge(StatsCollector &&later);
+  TableStats result() const;
+  // Name of the first column whose values appeared in non-decreasing order,
+  // or an empty string
+  std::string sort_column() const;
+};
+
+#endif // TABLE_STATS_H
@@ -0,0 +1,61 @@
+#include "zone_map.h"
+#include "join_operation.h"
+#include "table.h"
+
+int ZoneMap::slot(size_t column) const {
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i] == column) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void ZoneMap::track(size_t column) {
+  if (!tracks(column)) {
+    columns.push_back(column);
+    zones.emplace_back();
+  }
+}
+
+void ZoneMap::record(const Schema &schema, const Page &page) {
+  if (columns.empty()) {
+    return;
+  }
+  size_t page_id = static_cast<size_t>(page.page_id);
+  for (size_t i = 0; i < columns.size(); ++i) {
+    PageZone zone;
+    for (size_t r = 0; r < page.rows.size(); ++r) {
+      Value value = schema.column_value(page.rows[r], columns[i]);
+      if (!zone.has_rows) {
+        zone.min_value = value;
+        zone.max_value = std::move(value);
+        zone.has_rows = true;
+      } else if (JoinOperations::compare_values(value, zone.min_value) < 0) {
+        zone.min_value = std::move(value);
+      } else if (JoinOperations::compare_values(value, zone.max_value) > 0) {
+        zone.max_value = std::move(value);
+      }
+    }
+    if (page_id >= zones[i].size()) {
+      zones[i].resize(page_id + 1);
+    }
+    zones[i][page_id] = std::move(zone);
+  }
+}
+
+const PageZone *ZoneMap::find(size_t column, int page_id) const {
+  int i = slot(column);
+  if (i < 0 || page_id < 0 ||
+      static_cast<size_t>(page_id) >= zones[i].size() ||
+      !zones[i][page_id]) {
+    return nullptr;
+  }
+  return &*zones[i][page_id];
+}
+
+void ZoneMap::clear() {
+  for (auto &column_zones : zones) {
+    column_zones.clear();
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include "schema.h"
+#include <optional>
+#include <vector>
+
+struct Page;
+
+// Smallest and largest value of one column among the rows of a page
+struct PageZone {
+  bool has_rows = false; // False for an empty page
+  Value min_value;
+  Value max_value;
+};
+
+// Per-page min/max summaries of chosen columns of a table. The table records
+// every page it writes, so a scan can tell from the zones alone that a page
+// holds no value in a key range and skip reading it. Zones live in memory
+// only; a table reopened from the catalog starts without them.
+class ZoneMap {
+private:
+  std::vector<size_t> columns; // Schema indices tracked
+  // Per tracked column, per page; empty for pages not recorded since the
+  // column was tracked
+  std::vector<std::vector<std::optional<PageZone>>> zones;
+
+  int slot(size_t column) const;
+
+public:
+  // Pages recorded before have no zone for the column, so scans read them
+  void track(size_t column);
+  bool tracks(size_t column) const { return slot(column) >= 0; }
+
+  // Computes the zones of every tracked column from the page's rows
+  void record(const Schema &schema, const Page &page);
+  // The zone of a page, or null when the column is not tracked or the page
+  // was not recorded since it was
+  const PageZone *find(size_t column, int page_id) const;
+  // Forgets every page; the tracked columns stay
+  void clear();
+};
+
+#endif // ZONE_MAP_H